@@ -4,6 +4,7 @@ System::Console::ReadKey(true);
 #pragma once
 #include <NetworkedModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 
 using namespace System;
 using namespace System::Threading;
@@ -12,9 +13,10 @@ ref class LiDAR : public NetworkedModule
 {
 public:
     // 通过构造函数把 SM 指针交进来（C++/CLI，方便设置到基类的 SM_TM_）
-    LiDAR(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_lidar) {
+    LiDAR(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_lidar, SM_Stats^ sm_s) {
         SM_TM_ = sm_tm;
         SM_L_  = sm_lidar;
+        SM_S_  = sm_s;
     }
 
     // Week8 不要求真实网络通信，下面两个是占位即可
@@ -29,9 +31,34 @@ public:
 
     virtual void threadFunction() override;
 
+    // SM 写入（Bench 里也要直接计时，所以放 public）
+    void writeScanToSharedMemory(const array<double>^ x, const array<double>^ y);
+
+    // 每帧之间的休眠（默认 40 ms ≈ 25 Hz）；0 = 不休眠，Bench 用来测解析/发布上限
+    void setPollInterval(int ms) { pollMs_ = ms; }
+    // 每 N 帧打印一次 "live" 日志（默认每帧）；0 = 不打印。Bench 关掉它，免得测的是控制台 I/O
+    void setLogEvery(int n) { logEvery_ = n; }
+
+    // —— 解析步骤拆成静态函数，threadFunction 和 Bench 共用 —— //
+    enum class ParseResult { OK, NO_DIST1, BAD_COUNT };
+
+    // 从 carry 里切出一帧（去掉 STX/ETX），处理半包/粘包；切到返回 true
+    static bool extractFrame(String^% carry, String^% frame);
+    // 定位 DIST1 并把十六进制距离(mm)写进 ranges；count/tokens 用于日志
+    static ParseResult parseDist1(String^ frame, array<int>^ ranges, int% count, int% tokens);
+    // 极坐标(mm) → 笛卡尔(m)；0..180°，步距 0.5°，查 cos/sin 表
+    static void polarToCartesian(array<int>^ ranges, array<double>^ x, array<double>^ y);
+
 private:
     SM_Lidar^ SM_L_;
-    void writeScanToSharedMemory(const array<double>^ x, const array<double>^ y);
+    SM_Stats^ SM_S_;
+    int pollMs_ = 40;
+    int logEvery_ = 1;
+
+    // 每个 beam 的 cos/sin（第 i 束 = 0.5*i 度），启动时算一次
+    static array<double>^ makeTrigTable(bool cosine);
+    static array<double>^ cosTable_ = makeTrigTable(true);
+    static array<double>^ sinTable_ = makeTrigTable(false);
 };
 
 
@@ -46,9 +73,10 @@ using namespace System::Text;
 using namespace System::Globalization;
 
 // ===== ctor =====
-LiDAR::LiDAR(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l) {
+LiDAR::LiDAR(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_Stats^ sm_s) {
     SM_TM_ = sm_tm;
     SM_L_  = sm_l;
+    SM_S_  = sm_s;
 }
 
 // ===== SM writer =====
@@ -61,10 +89,84 @@ void LiDAR::writeScanToSharedMemory(const array<double>^ x, const array<double>^
             SM_L_->x[i] = x[i];
             SM_L_->y[i] = y[i];
         }
+        // 代数/时间戳在锁内更新，读者在锁内读到的和数据一致
+        if (SM_S_) {
+            SM_S_->inc(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_GEN);
+            SM_S_->set(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_TICKS, System::Diagnostics::Stopwatch::GetTimestamp());
+        }
     }
     finally { Monitor::Exit(SM_L_->lockObject); }
 }
 
+// ===== 帧切分：读取到 ETX；去除 STX/ETX，留下纯 ASCII 帧 =====
+bool LiDAR::extractFrame(String^% carry, String^% frame)
+{
+    int stx = carry->IndexOf((wchar_t)0x02);
+    if (stx < 0) return false;
+    int etx = carry->IndexOf((wchar_t)0x03, stx + 1);
+    if (etx < 0) return false;
+    frame = carry->Substring(stx + 1, etx - stx - 1);
+    carry = carry->Substring(etx + 1);
+    return true;
+}
+
+// ===== 解析：稳健定位 DIST1 的“点数”和数据起始下标 =====
+LiDAR::ParseResult LiDAR::parseDist1(String^ frame, array<int>^ ranges, int% count, int% tokens)
+{
+    array<wchar_t>^ sep = gcnew array<wchar_t>{ ' ' };
+    array<String^>^ tok = frame->Split(sep, StringSplitOptions::RemoveEmptyEntries);
+    tokens = tok->Length;
+    count  = -1;
+
+    int idx = Array::IndexOf(tok, "DIST1");
+    if (idx < 0) return ParseResult::NO_DIST1;
+
+    // 有些实现会在 DIST1 后给出 scale/offset 等，点数并非紧随其后
+    int dataStart = -1;
+    for (int j = idx + 1; j < Math::Min(idx + 12, tok->Length); ++j) {
+        int tryCount = 0;
+        bool ok = Int32::TryParse(tok[j], NumberStyles::HexNumber, nullptr, tryCount);
+        // 合理范围过滤（361 属于此范围），并确保后续 token 足够承载
+        if (ok && tryCount >= 10 && tryCount <= 2000) {
+            if (j + 1 + tryCount <= tok->Length) {
+                count = tryCount;
+                dataStart = j + 1;
+                break;
+            }
+        }
+    }
+    if (count != ranges->Length || dataStart < 0) return ParseResult::BAD_COUNT;
+
+    for (int i = 0; i < count; ++i) {
+        int r_mm = 0;
+        Int32::TryParse(tok[dataStart + i], NumberStyles::HexNumber, nullptr, r_mm);
+        ranges[i] = r_mm;
+    }
+    return ParseResult::OK;
+}
+
+// ===== trig 表：0..180°，步距 0.5° =====
+array<double>^ LiDAR::makeTrigTable(bool cosine)
+{
+    array<double>^ t = gcnew array<double>(STANDARD_LIDAR_LENGTH);
+    for (int i = 0; i < t->Length; ++i) {
+        double rad = 0.5 * i * Math::PI / 180.0;
+        t[i] = cosine ? Math::Cos(rad) : Math::Sin(rad);
+    }
+    return t;
+}
+
+// ===== 极坐标(mm) → 笛卡尔(m) =====
+void LiDAR::polarToCartesian(array<int>^ ranges, array<double>^ x, array<double>^ y)
+{
+    int n = Math::Min(ranges->Length, cosTable_->Length);
+    for (int i = 0; i < n; ++i) {
+        double r = ranges[i] / 1000.0;                  // mm → m
+        x[i] = r * cosTable_[i];
+        y[i] = r * sinTable_[i];
+    }
+}
+
 // ===== main thread loop =====
 void LiDAR::threadFunction()
 {
@@ -106,88 +208,66 @@ void LiDAR::threadFunction()
     const int N = STANDARD_LIDAR_LENGTH;           // 361
     array<double>^ x = gcnew array<double>(N);
     array<double>^ y = gcnew array<double>(N);
+    array<int>^ ranges = gcnew array<int>(N);
     int frameId = 0;
 
     while (!getShutdownFlag()) {
         // 发送请求
         stream->Write(req, 0, req->Length);
 
-        // 读取到 ETX；去除 STX/ETX，留下纯 ASCII 帧
+        // 读取到 ETX；粘包时 carry 里可能已有完整帧，先切再读
         String^ frame = nullptr;
-        for (;;) {
+        while (!extractFrame(carry, frame)) {
             int m = 0;
             try { m = stream->Read(rx, 0, rx->Length); }
             catch (Exception^ e) { Console::WriteLine("[LiDAR] Read error: {0}", e->Message); return; }
             if (m <= 0) { Console::WriteLine("[LiDAR] connection closed."); return; }
-
-            String^ chunk = Encoding::ASCII->GetString(rx, 0, m);
-            carry += chunk;
-
-            int stx = carry->IndexOf((wchar_t)0x02);
-            int etx = carry->IndexOf((wchar_t)0x03);
-            if (stx >= 0 && etx > stx) {
-                frame = carry->Substring(stx + 1, etx - stx - 1);
-                carry = carry->Substring(etx + 1);
-                break;
+            if (SM_S_) SM_S_->add(SM_Stats::M_LIDAR, SM_Stats::C_BYTES_RX, m);
+
+            carry += Encoding::ASCII->GetString(rx, 0, m);
+            if (carry->Length > 60000) {
+                // 一直凑不出完整帧：整段丢掉，同样记一次丢帧
+                Console::WriteLine("[LiDAR] carry too long, reset.");
+                carry = "";
+                if (SM_S_) SM_S_->inc(SM_Stats::M_LIDAR, SM_Stats::C_FRAMES_DROPPED);
             }
-            if (carry->Length > 60000) { Console::WriteLine("[LiDAR] carry too long, reset."); carry = ""; }
         }
 
-        // === 4) 解析：稳健定位 DIST1 的“点数”和数据起始下标 ===
-
-        array<wchar_t>^ sep = gcnew array<wchar_t>{ ' ' };
-        array<String^>^ tok = frame->Split(sep, StringSplitOptions::RemoveEmptyEntries);
-
-        
-        //array<String^>^ tok = frame->Split(' ', StringSplitOptions::RemoveEmptyEntries);
-        int idx = Array::IndexOf(tok, "DIST1");
-        if (idx < 0) {
+        // === 4) 解析 DIST1 ===
+        if (SM_S_) SM_S_->inc(SM_Stats::M_LIDAR, SM_Stats::C_LOOPS);
+        int count = -1, tokens = 0;
+        ParseResult pr = parseDist1(frame, ranges, count, tokens);
+        if (pr != ParseResult::OK && SM_S_) SM_S_->inc(SM_Stats::M_LIDAR, SM_Stats::C_FRAMES_DROPPED);
+        if (pr == ParseResult::NO_DIST1) {
             int preview = Math::Min(frame->Length, 120);
             Console::WriteLine("[LiDAR] DIST1 not found. head='{0}'", frame->Substring(0, preview));
             continue;
         }
-
-        // 有些实现会在 DIST1 后给出 scale/offset 等，点数并非紧随其后
-        int count = -1;
-        int dataStart = -1;
-        for (int j = idx + 1; j < Math::Min(idx + 12, tok->Length); ++j) {
-            int tryCount = 0;
-            bool ok = Int32::TryParse(tok[j], NumberStyles::HexNumber, nullptr, tryCount);
-            // 合理范围过滤（361 属于此范围），并确保后续 token 足够承载
-            if (ok && tryCount >= 10 && tryCount <= 2000) {
-                if (j + 1 + tryCount <= tok->Length) {
-                    count = tryCount;
-                    dataStart = j + 1;
-                    break;
-                }
-            }
-        }
-
-        if (count != N || dataStart < 0) {
-            Console::WriteLine("[LiDAR] count/offset unresolved. got count={0}, tokens={1}", count, tok->Length);
+        if (pr == ParseResult::BAD_COUNT) {
+            Console::WriteLine("[LiDAR] count/offset unresolved. got count={0}, tokens={1}", count, tokens);
             continue;
         }
 
-        // === 5) 极坐标(mm) → 笛卡尔(m)；0..180°，步距 0.5°
+        if (SM_S_) SM_S_->inc(SM_Stats::M_LIDAR, SM_Stats::C_FRAMES_PARSED);
+
+        // === 5) 极坐标(mm) → 笛卡尔(m)
+        polarToCartesian(ranges, x, y);
         double minr = 1e9, maxr = -1e9;
         for (int i = 0; i < N; ++i) {
-            int r_mm = 0;
-            Int32::TryParse(tok[dataStart + i], NumberStyles::HexNumber, nullptr, r_mm);
-            double r   = r_mm / 1000.0;                 // mm → m
-            double deg = 0.5 * i;                       // 0..180
-            double rad = deg * Math::PI / 180.0;
-            x[i] = r * Math::Cos(rad);
-            y[i] = r * Math::Sin(rad);
+            double r = ranges[i] / 1000.0;
             if (r > 0) { if (r < minr) minr = r; if (r > maxr) maxr = r; }
         }
 
         // === 6) 写共享内存 + 打印“live”证据 ===
         writeScanToSharedMemory(x, y);
 
-        Console::Write("[LiDAR] frame {0}  n={1}  r[min,max]=[{2:F2},{3:F2}]  first10: ",
-            ++frameId, N, (minr<1e8?minr:0), (maxr>-1e8?maxr:0));
-        for (int i = 0; i < 10; ++i) Console::Write("( {0:F3},{1:F3} ) ", x[i], y[i]);
-        Console::WriteLine();
+        ++frameId;
+        if (logEvery_ > 0 && frameId % logEvery_ == 0) {
+            Console::Write("[LiDAR] frame {0}  n={1}  r[min,max]=[{2:F2},{3:F2}]  first10: ",
+                frameId, N, (minr<1e8?minr:0), (maxr>-1e8?maxr:0));
+            for (int i = 0; i < 10; ++i) Console::Write("( {0:F3},{1:F3} ) ", x[i], y[i]);
+            Console::WriteLine();
+        }
 
         // 心跳（可选）
         if (SM_TM_) {
@@ -196,7 +276,7 @@ void LiDAR::threadFunction()
             finally { Monitor::Exit(SM_TM_->lockObject); }
         }
 
-        Thread::Sleep(40); // ~25 Hz
+        if (pollMs_ > 0) Thread::Sleep(pollMs_); // 默认 ~25 Hz
     }
 
     Console::WriteLine("[LiDAR] thread exit.");
@@ -210,6 +290,7 @@ void LiDAR::threadFunction()
 #pragma once
 #include <UGVModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 
 ref class LiDAR;            // 前置声明（与各模块解耦）
 ref class Display;
@@ -217,6 +298,7 @@ ref class GNSS;
 ref class Controller;
 ref class VC;
 ref class CrashAvoidance;
+ref class Tracker;
 
 ref class ThreadManagement : public UGVModule {
 public:
@@ -235,11 +317,42 @@ public:
     // Thread function for TMM
     void threadFunction() override;
 
+    // 只读访问 LiDAR SM（Bench 用来测端到端延迟；setupSharedMemory 之前为 nullptr）
+    SM_Lidar^ getLidarSM() { return SM_L_; }
+
+    // 在 threadFunction 之前调用；传给 LiDAR::setPollInterval（-1 = 保持 LiDAR 默认）
+    void setLidarPollInterval(int ms) { lidarPollMs_ = ms; }
+    // 同上，传给 LiDAR::setLogEvery（-1 = 保持默认）
+    void setLidarLogEvery(int n) { lidarLogEvery_ = n; }
+
+    // 只读访问运行时计数器（Bench 从发布端取帧数）
+    SM_Stats^ getStatsSM() { return SM_S_; }
+
+    // "UGV_Stats" 页布局（全部 Int64）：magic, seq, 时间戳(UTC ticks), 心跳位, 模块数, 计数器数,
+    // 然后 [模块][计数器] 计数值，再是每个模块相对 SM_Lidar 的 reader lag（非读者为 -1）。
+    // seq 为奇数表示正在写，读端前后 seq 相同才算有效快照。
+    literal String^ STATS_MAP_NAME = "UGV_Stats";
+    literal __int64 STATS_MAGIC    = 0x3154415453564755;   // "UGVSTAT1"
+    literal int     STATS_HEADER   = 6 * 8;
+    literal int     STATS_SIZE     = STATS_HEADER + SM_Stats::NUM_MODULES * (SM_Stats::NUM_COUNTERS + 1) * 8;
+
 private:
+    // 把 SM_Stats 拷到共享内存页，由 TMM 主循环调用（不碰各模块的热循环）
+    void exportStats();
     // 共享内存
     SM_Lidar^    SM_L_   = nullptr;
     SM_GNSS^     SM_G_   = nullptr;
     SM_VehicleControl^ SM_VC_ = nullptr;
+    SM_Objects^  SM_O_   = nullptr;
+    SM_Stats^    SM_S_   = nullptr;
+
+    // introspection 导出
+    System::IO::MemoryMappedFiles::MemoryMappedFile^         statsMap_  = nullptr;
+    System::IO::MemoryMappedFiles::MemoryMappedViewAccessor^ statsView_ = nullptr;
+    __int64 statsSeq_      = 0;
+    int     lastHeartbeat_ = 0;     // 最近两个周期内置过的心跳位
+    int     lidarPollMs_   = -1;
+    int     lidarLogEvery_ = -1;
 
     // 其他模块实例
     LiDAR^          lidar_ = nullptr;
@@ -248,6 +361,7 @@ private:
     Controller^     controller_ = nullptr;
     VC^             vc_ = nullptr;
     CrashAvoidance^ crash_ = nullptr;
+    Tracker^        tracker_ = nullptr;
 };
 
 
@@ -259,9 +373,11 @@ private:
 #include "Controller.h"
 #include "VC.h"
 #include "CrashAvoidance.h"
+#include "Tracker.h"
 
 using namespace System;
 using namespace System::Threading;
+using namespace System::IO::MemoryMappedFiles;
 
 error_state ThreadManagement::setupSharedMemory() {
     // 创建并挂到基类指针（供所有模块共享）
@@ -269,6 +385,19 @@ error_state ThreadManagement::setupSharedMemory() {
     SM_L_  = gcnew SM_Lidar();
     SM_G_  = gcnew SM_GNSS();
     SM_VC_ = gcnew SM_VehicleControl();
+    SM_O_  = gcnew SM_Objects();
+    SM_S_  = gcnew SM_Stats();
+
+    // 只读 introspection 页，外部 UGVStats 工具轮询
+    try {
+        statsMap_  = MemoryMappedFile::CreateOrOpen(STATS_MAP_NAME, STATS_SIZE);
+        statsView_ = statsMap_->CreateViewAccessor(0, STATS_SIZE);
+        statsView_->Write(0, STATS_MAGIC);
+    }
+    catch (Exception^ e) {
+        Console::WriteLine("[TMM] stats page unavailable: {0}", e->Message);
+        statsView_ = nullptr;
+    }
 
     // 心跳 WatchList 可选；Week8 不强制用，演示时可忽略
     return error_state::SUCCESS;
@@ -278,12 +407,42 @@ error_state ThreadManagement::processSharedMemory() {
     // 这里可以做一点点心跳监测（演示“通信”），例如每个周期把 heartbeat 清零
     if (SM_TM_) {
         Monitor::Enter(SM_TM_->lockObject);
-        try { SM_TM_->heartbeat = 0; }
+        try {
+            // 清零前记下本周期的心跳；GNSS 150 ms 一拍，所以和上一周期合并
+            int beats = SM_TM_->heartbeat;
+            SM_TM_->heartbeat = 0;
+            lastHeartbeat_ = (lastHeartbeat_ << 8 | beats) & 0xFFFF;
+        }
         finally { Monitor::Exit(SM_TM_->lockObject); }
     }
     return error_state::SUCCESS;
 }
 
+void ThreadManagement::exportStats() {
+    if (!statsView_ || !SM_S_) return;
+    const int M = SM_Stats::NUM_MODULES, C = SM_Stats::NUM_COUNTERS;
+    __int64 lidarGen = SM_S_->get(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_GEN);
+
+    statsView_->Write(8, ++statsSeq_);          // 奇数：写入中
+    Thread::MemoryBarrier();
+    statsView_->Write(16, DateTime::UtcNow.Ticks);
+    statsView_->Write(24, (__int64)((lastHeartbeat_ | lastHeartbeat_ >> 8) & 0xFF));
+    statsView_->Write(32, (__int64)M);
+    statsView_->Write(40, (__int64)C);
+    int pos = STATS_HEADER;
+    for (int m = 0; m < M; ++m)
+        for (int c = 0; c < C; ++c, pos += 8)
+            statsView_->Write(pos, SM_S_->get(m, c));
+    for (int m = 0; m < M; ++m, pos += 8) {
+        // Display 只在有 viewer 时读 SM_Lidar，其余时间写 -1，不算落后的读者
+        bool reader = (m == SM_Stats::M_DISPLAY || m == SM_Stats::M_TRACKER);
+        __int64 seen = reader ? SM_S_->get(m, SM_Stats::C_LIDAR_GEN_SEEN) : -1;
+        statsView_->Write(pos, (seen >= 0) ? lidarGen - seen : (__int64)-1);
+    }
+    Thread::MemoryBarrier();
+    statsView_->Write(8, ++statsSeq_);          // 偶数：完成
+}
+
 void ThreadManagement::shutdownModules() {
     if (SM_TM_) {
         SM_TM_->shutdown = 0xFF; // 非 0 即触发所有模块退出
@@ -300,12 +459,15 @@ void ThreadManagement::threadFunction() {
     setupSharedMemory();
 
     // —— 创建各模块并传入共享内存 —— //
-    lidar_      = gcnew LiDAR(SM_TM_, SM_L_);
-    display_    = gcnew Display(SM_TM_, SM_L_);         // 下文提供最小骨架
-    gnss_       = gcnew GNSS(SM_TM_, SM_G_);
-    controller_ = gcnew Controller(SM_TM_, SM_L_, SM_G_, SM_VC_);
-    vc_         = gcnew VC(SM_TM_, SM_VC_);
-    crash_      = gcnew CrashAvoidance(SM_TM_, SM_L_, SM_VC_);
+    lidar_      = gcnew LiDAR(SM_TM_, SM_L_, SM_S_);
+    display_    = gcnew Display(SM_TM_, SM_L_, SM_S_);
+    gnss_       = gcnew GNSS(SM_TM_, SM_G_, SM_S_);
+    controller_ = gcnew Controller(SM_TM_, SM_L_, SM_G_, SM_VC_, SM_S_);
+    vc_         = gcnew VC(SM_TM_, SM_VC_, SM_S_);
+    crash_      = gcnew CrashAvoidance(SM_TM_, SM_L_, SM_O_, SM_VC_, SM_S_);
+    tracker_    = gcnew Tracker(SM_TM_, SM_L_, SM_O_, SM_S_);
+    if (lidarPollMs_ >= 0) lidar_->setPollInterval(lidarPollMs_);
+    if (lidarLogEvery_ >= 0) lidar_->setLogEvery(lidarLogEvery_);
 
     // —— 启动线程 —— //
     Thread^ thL = gcnew Thread(gcnew ThreadStart(lidar_,      &LiDAR::threadFunction));
@@ -314,14 +476,15 @@ void ThreadManagement::threadFunction() {
     Thread^ thC = gcnew Thread(gcnew ThreadStart(controller_, &Controller::threadFunction));
     Thread^ thV = gcnew Thread(gcnew ThreadStart(vc_,         &VC::threadFunction));
     Thread^ thA = gcnew Thread(gcnew ThreadStart(crash_,      &CrashAvoidance::threadFunction));
+    Thread^ thT = gcnew Thread(gcnew ThreadStart(tracker_,    &Tracker::threadFunction));
 
-    thL->Start(); thD->Start(); thG->Start(); thC->Start(); thV->Start(); thA->Start();
+    thL->Start(); thD->Start(); thG->Start(); thC->Start(); thV->Start(); thA->Start(); thT->Start();
 
     Console::WriteLine("[TMM] Press 'q' to shutdown.");
 
-    // —— 键盘监听（C++/CLI，用 Console::KeyAvailable） —— //
+    // —— 键盘监听（C++/CLI，用 Console::KeyAvailable；stdin 被重定向时会抛异常，跳过） —— //
     while (!getShutdownFlag()) {
-        if (Console::KeyAvailable) {
+        if (!Console::IsInputRedirected && Console::KeyAvailable) {
             auto key = Console::ReadKey(true).Key;
             if (key == ConsoleKey::Q) {
                 Console::WriteLine("[TMM] Shutdown requested.");
@@ -329,13 +492,16 @@ void ThreadManagement::threadFunction() {
                 break;
             }
         }
-        // 演示通信：周期性清 heartbeat
+        // 演示通信：周期性清 heartbeat，并导出计数器
         processSharedMemory();
+        SM_S_->inc(SM_Stats::M_TMM, SM_Stats::C_LOOPS);
+        exportStats();
         Thread::Sleep(100);
     }
 
     // —— 等待所有线程退出 —— //
-    thL->Join(); thD->Join(); thG->Join(); thC->Join(); thV->Join(); thA->Join();
+    thL->Join(); thD->Join(); thG->Join(); thC->Join(); thV->Join(); thA->Join(); thT->Join();
+    if (statsView_) { delete statsView_; delete statsMap_; }
     Console::WriteLine("[TMM] all threads exited.");
 }
 
@@ -363,27 +529,243 @@ int main(array<System::String ^> ^)
 #pragma once
 #include <UGVModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 using namespace System;
 using namespace System::Threading;
+using namespace System::Net::Sockets;
 
+// 把 SM_Lidar 推给外部 viewer（127.0.0.1:24000，TCP）
+// 帧格式（小端）：[len:u32][type:u8 0=key 1=delta][seq:u32][n:u16] + n × [idx:u16][qx:i16][qy:i16]
+// q = 坐标 / VIEW_RES_M；delta 帧只带和上次发送不同的点
+// 永不阻塞传感器/控制线程：SM 用 TryEnter 取快照，socket 非阻塞，发不出去就丢帧
 ref class Display : public UGVModule {
 public:
-    Display(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l) { SM_TM_ = sm_tm; SM_L_ = sm_l; }
+    Display(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_Stats^ sm_s);
     virtual error_state processSharedMemory() override { return error_state::SUCCESS; }
     virtual bool getShutdownFlag() override { return (SM_TM_!=nullptr) && (SM_TM_->shutdown!=0); }
     virtual void threadFunction() override;
 private:
+    literal int    VIEW_PORT    = 24000;
+    literal int    MAX_FPS      = 15;
+    literal int    DECIMATE     = 2;      // 每 2 束取一个点（取近的那束，障碍物不丢）
+    literal double VIEW_RES_M   = 0.05;   // viewer 像素对应 5 cm
+    literal int    KEY_INTERVAL = 30;     // 至少每 2 s 一个关键帧
+
+    bool takeSnapshot();
+    void decimate();
+    int  buildFrame(bool key);
+    bool flushPending();
+    void acceptViewer();
+    void dropViewer();
+
     SM_Lidar^ SM_L_;
+    SM_Stats^ SM_S_;
+
+    array<double>^ sx_;          // SM 快照
+    array<double>^ sy_;
+    array<short>^  qx_;          // 抽稀 + 量化后
+    array<short>^  qy_;
+    array<short>^  sentX_;       // viewer 端已有的内容
+    array<short>^  sentY_;
+
+    TcpListener^   listener_;
+    Socket^        viewer_;
+    array<Byte>^   sendBuf_;
+    int            pendingOff_;  // sendBuf_ 里还没发完的部分
+    int            pendingLen_;
+    __int64        pendingT0_;   // 在途帧数据的 LiDAR 发布时刻（Stopwatch ticks）
+    __int64        snapT0_;      // 最近快照数据的 LiDAR 发布时刻
+    bool           needKey_;
+    unsigned int   seq_;
+
+    // 统计（每秒打印一次）
+    __int64 bytesSent_;
+    int     framesSent_;
+    int     framesSkipped_;
+    double  lagSumMs_;      // render lag：LiDAR 发布 → 整帧写进 socket
+    double  lagMaxMs_;
 };
 
 // Display.cpp
 #include "Display.h"
+using namespace System::Net;
+using namespace System::Diagnostics;
+
+Display::Display(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_Stats^ sm_s) {
+    SM_TM_ = sm_tm; SM_L_ = sm_l; SM_S_ = sm_s;
+    int n = (STANDARD_LIDAR_LENGTH + DECIMATE - 1) / DECIMATE;
+    sx_ = gcnew array<double>(STANDARD_LIDAR_LENGTH);
+    sy_ = gcnew array<double>(STANDARD_LIDAR_LENGTH);
+    qx_ = gcnew array<short>(n);
+    qy_ = gcnew array<short>(n);
+    sentX_ = gcnew array<short>(n);
+    sentY_ = gcnew array<short>(n);
+    sendBuf_ = gcnew array<Byte>(4 + 1 + 4 + 2 + 6 * n);
+    pendingOff_ = pendingLen_ = 0;
+    pendingT0_ = snapT0_ = 0;
+    needKey_ = true;
+    seq_ = 0;
+    bytesSent_ = 0; framesSent_ = framesSkipped_ = 0;
+    lagSumMs_ = lagMaxMs_ = 0;
+}
+
+// 锁被 LiDAR 占着就直接放弃这一帧，绝不等
+bool Display::takeSnapshot() {
+    if (!SM_L_ || !Monitor::TryEnter(SM_L_->lockObject, 0)) return false;
+    try {
+        Array::Copy(SM_L_->x, sx_, sx_->Length);
+        Array::Copy(SM_L_->y, sy_, sy_->Length);
+        if (SM_S_) SM_S_->set(SM_Stats::M_DISPLAY, SM_Stats::C_LIDAR_GEN_SEEN, SM_S_->get(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_GEN));
+        // 数据年龄从 LiDAR 发布算起；没有计数器（或还没发布过）就退化为快照时刻
+        snapT0_ = SM_S_ ? SM_S_->get(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_TICKS) : 0;
+        if (snapT0_ == 0) snapT0_ = Stopwatch::GetTimestamp();
+    }
+    finally { Monitor::Exit(SM_L_->lockObject); }
+    return true;
+}
+
+void Display::decimate() {
+    for (int k = 0; k < qx_->Length; ++k) {
+        int best = k * DECIMATE;
+        double bestR2 = Double::MaxValue;
+        for (int i = k * DECIMATE; i < Math::Min((k + 1) * DECIMATE, sx_->Length); ++i) {
+            double r2 = sx_[i] * sx_[i] + sy_[i] * sy_[i];
+            if (r2 > 1e-6 && r2 < bestR2) { bestR2 = r2; best = i; }
+        }
+        qx_[k] = (short)Math::Round(Math::Max(-32767.0, Math::Min(32767.0, sx_[best] / VIEW_RES_M)));
+        qy_[k] = (short)Math::Round(Math::Max(-32767.0, Math::Min(32767.0, sy_[best] / VIEW_RES_M)));
+    }
+}
+
+// 写入 sendBuf_，返回帧长；delta 帧无变化时返回 0
+int Display::buildFrame(bool key) {
+    int pos = 4 + 1 + 4 + 2;
+    int n = 0;
+    for (int k = 0; k < qx_->Length; ++k) {
+        if (!key && qx_[k] == sentX_[k] && qy_[k] == sentY_[k]) continue;
+        sendBuf_[pos++] = (Byte)k;          sendBuf_[pos++] = (Byte)(k >> 8);
+        sendBuf_[pos++] = (Byte)qx_[k];     sendBuf_[pos++] = (Byte)(qx_[k] >> 8);
+        sendBuf_[pos++] = (Byte)qy_[k];     sendBuf_[pos++] = (Byte)(qy_[k] >> 8);
+        ++n;
+    }
+    if (n == 0) return 0;
+
+    int len = pos;
+    unsigned int s = seq_;
+    sendBuf_[0] = (Byte)len;  sendBuf_[1] = (Byte)(len >> 8);  sendBuf_[2] = (Byte)(len >> 16);  sendBuf_[3] = (Byte)(len >> 24);
+    sendBuf_[4] = key ? (Byte)0 : (Byte)1;
+    sendBuf_[5] = (Byte)s;    sendBuf_[6] = (Byte)(s >> 8);    sendBuf_[7] = (Byte)(s >> 16);    sendBuf_[8] = (Byte)(s >> 24);
+    sendBuf_[9] = (Byte)n;    sendBuf_[10] = (Byte)(n >> 8);
+    return len;
+}
+
+// 非阻塞发送剩余部分；发完返回 true。WouldBlock 返回 false 且 viewer_ 仍在；出错断开 viewer（viewer_ 置空）
+// 帧在哪一拍发完就在哪一拍记 framesSent_ 和 render lag（背压下跨拍发完的帧也算）
+bool Display::flushPending() {
+    if (pendingLen_ == 0) return true;
+    while (pendingOff_ < pendingLen_) {
+        SocketError err;
+        int m = viewer_->Send(sendBuf_, pendingOff_, pendingLen_ - pendingOff_, SocketFlags::None, err);
+        if (err == SocketError::WouldBlock) return false;
+        if (err != SocketError::Success || m <= 0) { dropViewer(); return false; }
+        pendingOff_ += m;
+        bytesSent_ += m;
+    }
+    double lag = (Stopwatch::GetTimestamp() - pendingT0_) * 1000.0 / Stopwatch::Frequency;
+    ++framesSent_;
+    lagSumMs_ += lag;
+    if (lag > lagMaxMs_) lagMaxMs_ = lag;
+    pendingOff_ = pendingLen_ = 0;
+    return true;
+}
+
+void Display::acceptViewer() {
+    if (viewer_ || !listener_->Pending()) return;
+    viewer_ = listener_->AcceptSocket();
+    viewer_->Blocking = false;
+    viewer_->NoDelay  = true;
+    pendingOff_ = pendingLen_ = 0;
+    needKey_ = true;
+    Console::WriteLine("[Display] viewer connected.");
+}
+
+void Display::dropViewer() {
+    if (!viewer_) return;
+    try { viewer_->Close(); } catch (Exception^) {}
+    viewer_ = nullptr;
+    pendingOff_ = pendingLen_ = 0;
+    if (SM_S_) SM_S_->set(SM_Stats::M_DISPLAY, SM_Stats::C_LIDAR_GEN_SEEN, -1);   // 没 viewer 就不读 SM_Lidar
+    Console::WriteLine("[Display] viewer disconnected.");
+}
+
 void Display::threadFunction() {
+    listener_ = gcnew TcpListener(IPAddress::Loopback, VIEW_PORT);
+    try { listener_->Start(); }
+    catch (SocketException^ e) { Console::WriteLine("[Display] listen failed: {0}", e->Message); listener_ = nullptr; }
+    if (SM_S_) SM_S_->set(SM_Stats::M_DISPLAY, SM_Stats::C_LIDAR_GEN_SEEN, -1);   // viewer 连上之前不是读者
+
+    Stopwatch^ clock = Stopwatch::StartNew();
+    const double periodMs = 1000.0 / MAX_FPS;
+    double nextTick = 0, nextReport = 1000;
+    int sinceKey = 0;
+
     while (!getShutdownFlag()) {
         // 心跳
         if (SM_TM_) { Monitor::Enter(SM_TM_->lockObject); try { SM_TM_->heartbeat |= bit_DISPLAY; } finally { Monitor::Exit(SM_TM_->lockObject); } }
-        Thread::Sleep(200);
+        if (SM_S_) SM_S_->inc(SM_Stats::M_DISPLAY, SM_Stats::C_LOOPS);
+
+        if (listener_) acceptViewer();
+
+        if (viewer_) {
+            // 上一帧还没发完 = 背压：丢掉这一帧。差分基准 sentX_/sentY_ 仍是 viewer 收到的那帧，
+            // 不需要关键帧；只有新 viewer 才需要（acceptViewer 会置 needKey_）
+            if (!flushPending()) {
+                if (viewer_) {
+                    ++framesSkipped_;
+                    if (SM_S_) SM_S_->inc(SM_Stats::M_DISPLAY, SM_Stats::C_FRAMES_DROPPED);
+                }
+                // 否则是发送出错、viewer 已断开：不算背压丢帧
+            }
+            else if (takeSnapshot()) {
+                decimate();
+                bool key = needKey_ || sinceKey >= KEY_INTERVAL;
+                int len = buildFrame(key);
+                if (len > 0) {
+                    pendingOff_ = 0; pendingLen_ = len;
+                    pendingT0_ = snapT0_;
+                    Array::Copy(qx_, sentX_, qx_->Length);
+                    Array::Copy(qy_, sentY_, qy_->Length);
+                    ++seq_;
+                    needKey_ = false;
+                    sinceKey = key ? 0 : sinceKey + 1;
+                    flushPending();
+                }
+            }
+            else {
+                ++framesSkipped_;
+                if (SM_S_) SM_S_->inc(SM_Stats::M_DISPLAY, SM_Stats::C_FRAMES_DROPPED);
+            }
+        }
+
+        // 每秒报告 bytes/sec 与 render lag（LiDAR 发布 → 发送完成）
+        double now = clock->Elapsed.TotalMilliseconds;
+        if (now >= nextReport) {
+            if (viewer_ || framesSent_ > 0)
+                Console::WriteLine("[Display] {0} fps  {1} B/s  lag avg={2:F2}ms max={3:F2}ms  skipped={4}",
+                    framesSent_, bytesSent_, framesSent_ ? lagSumMs_ / framesSent_ : 0.0, lagMaxMs_, framesSkipped_);
+            bytesSent_ = 0; framesSent_ = framesSkipped_ = 0; lagSumMs_ = lagMaxMs_ = 0;
+            nextReport = now + 1000;
+        }
+
+        // 帧率上限
+        nextTick += periodMs;
+        int sleepMs = (int)(nextTick - clock->Elapsed.TotalMilliseconds);
+        if (sleepMs > 0) Thread::Sleep(sleepMs);
+        else nextTick = clock->Elapsed.TotalMilliseconds;
     }
+
+    dropViewer();
+    if (listener_) listener_->Stop();
     Console::WriteLine("[Display] thread exit.");
 }
 
@@ -394,22 +776,24 @@ void Display::threadFunction() {
 #pragma once
 #include <UGVModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 using namespace System;
 using namespace System::Threading;
 
 ref class GNSS : public UGVModule {
 public:
-    GNSS(SM_ThreadManagement^ sm_tm, SM_GNSS^ sm_g) { SM_TM_ = sm_tm; SM_G_ = sm_g; }
+    GNSS(SM_ThreadManagement^ sm_tm, SM_GNSS^ sm_g, SM_Stats^ sm_s) { SM_TM_ = sm_tm; SM_G_ = sm_g; SM_S_ = sm_s; }
     virtual error_state processSharedMemory() override { return error_state::SUCCESS; }
     virtual bool getShutdownFlag() override { return (SM_TM_!=nullptr) && (SM_TM_->shutdown!=0); }
     virtual void threadFunction() override {
         while (!getShutdownFlag()) {
             if (SM_TM_) { Monitor::Enter(SM_TM_->lockObject); try { SM_TM_->heartbeat |= bit_GNSS; } finally { Monitor::Exit(SM_TM_->lockObject); } }
+            if (SM_S_) SM_S_->inc(SM_Stats::M_GNSS, SM_Stats::C_LOOPS);
             Thread::Sleep(150);
         }
         System::Console::WriteLine("[GNSS] thread exit.");
     }
-private: SM_GNSS^ SM_G_;
+private: SM_GNSS^ SM_G_; SM_Stats^ SM_S_;
 };
 
 
@@ -417,25 +801,27 @@ private: SM_GNSS^ SM_G_;
 #pragma once
 #include <UGVModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 using namespace System;
 using namespace System::Threading;
 
 ref class Controller : public UGVModule {
 public:
-    Controller(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_GNSS^ sm_g, SM_VehicleControl^ sm_vc) {
-        SM_TM_ = sm_tm; SM_L_ = sm_l; SM_G_ = sm_g; SM_VC_ = sm_vc;
+    Controller(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_GNSS^ sm_g, SM_VehicleControl^ sm_vc, SM_Stats^ sm_s) {
+        SM_TM_ = sm_tm; SM_L_ = sm_l; SM_G_ = sm_g; SM_VC_ = sm_vc; SM_S_ = sm_s;
     }
     virtual error_state processSharedMemory() override { return error_state::SUCCESS; }
     virtual bool getShutdownFlag() override { return (SM_TM_!=nullptr) && (SM_TM_->shutdown!=0); }
     virtual void threadFunction() override {
         while (!getShutdownFlag()) {
             if (SM_TM_) { Monitor::Enter(SM_TM_->lockObject); try { SM_TM_->heartbeat |= bit_CONTROLLER; } finally { Monitor::Exit(SM_TM_->lockObject); } }
+            if (SM_S_) SM_S_->inc(SM_Stats::M_CONTROLLER, SM_Stats::C_LOOPS);
             Thread::Sleep(80);
         }
         System::Console::WriteLine("[Controller] thread exit.");
     }
 private:
-    SM_Lidar^ SM_L_; SM_GNSS^ SM_G_; SM_VehicleControl^ SM_VC_;
+    SM_Lidar^ SM_L_; SM_GNSS^ SM_G_; SM_VehicleControl^ SM_VC_; SM_Stats^ SM_S_;
 };
 
 
@@ -446,42 +832,52 @@ private:
 #pragma once
 #include <UGVModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 using namespace System;
 using namespace System::Threading;
 
 ref class VC : public UGVModule {
 public:
-    VC(SM_ThreadManagement^ sm_tm, SM_VehicleControl^ sm_vc) { SM_TM_ = sm_tm; SM_VC_ = sm_vc; }
+    VC(SM_ThreadManagement^ sm_tm, SM_VehicleControl^ sm_vc, SM_Stats^ sm_s) { SM_TM_ = sm_tm; SM_VC_ = sm_vc; SM_S_ = sm_s; }
     virtual error_state processSharedMemory() override { return error_state::SUCCESS; }
     virtual bool getShutdownFlag() override { return (SM_TM_!=nullptr) && (SM_TM_->shutdown!=0); }
     virtual void threadFunction() override {
         while (!getShutdownFlag()) {
             if (SM_TM_) { Monitor::Enter(SM_TM_->lockObject); try { SM_TM_->heartbeat |= bit_VC; } finally { Monitor::Exit(SM_TM_->lockObject); } }
+            if (SM_S_) SM_S_->inc(SM_Stats::M_VC, SM_Stats::C_LOOPS);
             Thread::Sleep(100);
         }
         System::Console::WriteLine("[VC] thread exit.");
     }
-private: SM_VehicleControl^ SM_VC_;
+private: SM_VehicleControl^ SM_VC_; SM_Stats^ SM_S_;
 };
 
 
 #pragma once
 #include <UGVModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 
 using namespace System;
 
 ref class CrashAvoidance : public UGVModule {
 public:
-    CrashAvoidance(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_VehicleControl^ sm_vc);
+    CrashAvoidance(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_Objects^ sm_o, SM_VehicleControl^ sm_vc, SM_Stats^ sm_s);
 
     virtual error_state processSharedMemory() override;
     virtual bool getShutdownFlag() override;
     virtual void threadFunction() override;
 
 private:
+    literal double TTC_WARN = 1.5;      // 碰撞时间告警阈值 (s)
+
+    // 读 SM_Objects，返回正在靠近的障碍物中最小的碰撞时间（无则 +inf）
+    double minTimeToCollision(int% objId);
+
     SM_Lidar^ SM_L_;
+    SM_Objects^ SM_O_;
     SM_VehicleControl^ SM_VC_;
+    SM_Stats^ SM_S_;
 };
 
 
@@ -491,10 +887,12 @@ private:
 using namespace System;
 using namespace System::Threading;
 
-CrashAvoidance::CrashAvoidance(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_VehicleControl^ sm_vc) {
+CrashAvoidance::CrashAvoidance(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_Objects^ sm_o, SM_VehicleControl^ sm_vc, SM_Stats^ sm_s) {
     SM_TM_ = sm_tm;
     SM_L_  = sm_l;
+    SM_O_  = sm_o;
     SM_VC_ = sm_vc;
+    SM_S_  = sm_s;
 }
 
 error_state CrashAvoidance::processSharedMemory() {
@@ -505,14 +903,48 @@ bool CrashAvoidance::getShutdownFlag() {
     return (SM_TM_ != nullptr) && (SM_TM_->shutdown != 0);
 }
 
+double CrashAvoidance::minTimeToCollision(int% objId) {
+    double best = Double::PositiveInfinity;
+    objId = -1;
+    if (!SM_O_) return best;
+    Monitor::Enter(SM_O_->lockObject);
+    try {
+        for (int i = 0; i < SM_O_->count; ++i) {
+            double x = SM_O_->x[i], y = SM_O_->y[i];
+            double d = Math::Sqrt(x * x + y * y);
+            if (d < 1e-3) continue;
+            double closing = -(x * SM_O_->vx[i] + y * SM_O_->vy[i]) / d;   // 视线方向接近速度
+            if (closing <= 0) continue;
+            double ttc = d / closing;
+            if (ttc < best) { best = ttc; objId = SM_O_->id[i]; }
+        }
+    }
+    finally { Monitor::Exit(SM_O_->lockObject); }
+    return best;
+}
+
 void CrashAvoidance::threadFunction() {
+    bool warned = false;
     while (!getShutdownFlag()) {
+        // 运动障碍物：只在进入/离开告警状态时打印
+        int objId = -1;
+        double ttc = minTimeToCollision(objId);
+        if (ttc < TTC_WARN && !warned) {
+            Console::WriteLine("[CrashAvoidance] object {0} closing, TTC={1:F2}s", objId, ttc);
+            warned = true;
+        }
+        else if (ttc >= TTC_WARN && warned) {
+            Console::WriteLine("[CrashAvoidance] clear.");
+            warned = false;
+        }
+
         // 心跳置位（展示线程间通信）
         if (SM_TM_) {
             Monitor::Enter(SM_TM_->lockObject);
             try { SM_TM_->heartbeat |= bit_CRASHAVOIDANCE; }
             finally { Monitor::Exit(SM_TM_->lockObject); }
         }
+        if (SM_S_) SM_S_->inc(SM_Stats::M_CRASH, SM_Stats::C_LOOPS);
         Thread::Sleep(90);
     }
     Console::WriteLine("[CrashAvoidance] thread exit.");
@@ -528,10 +960,11 @@ void CrashAvoidance::threadFunction() {
 #pragma once
 #include <NetworkedModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 
 ref class LiDAR : public NetworkedModule {
 public:
-    LiDAR(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l);
+    LiDAR(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_Stats^ sm_s);
 
     // Week8 网络占位
     virtual error_state connect(String^ hostName, int portNumber) override;
@@ -541,8 +974,13 @@ public:
     virtual bool getShutdownFlag() override;
     virtual void threadFunction() override;
 
+    void setPollInterval(int ms) { pollMs_ = ms; }
+    void setLogEvery(int) {}    // 合成版本来就不逐帧打印
+
 private:
     SM_Lidar^ SM_L_;
+    SM_Stats^ SM_S_;
+    int pollMs_ = 50;
     void writeScanToSharedMemory(const array<double>^ x, const array<double>^ y);
 };
 
@@ -553,7 +991,7 @@ private:
 using namespace System;
 using namespace System::Threading;
 
-LiDAR::LiDAR(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l) { SM_TM_ = sm_tm; SM_L_ = sm_l; }
+LiDAR::LiDAR(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_Stats^ sm_s) { SM_TM_ = sm_tm; SM_L_ = sm_l; SM_S_ = sm_s; }
 error_state LiDAR::connect(String^, int){ return error_state::SUCCESS; }
 error_state LiDAR::communicate(){ return error_state::SUCCESS; }
 error_state LiDAR::processSharedMemory(){ return error_state::SUCCESS; }
@@ -567,11 +1005,15 @@ void LiDAR::writeScanToSharedMemory(const array<double>^ x, const array<double>^
             SM_L_->x[i] = x[i];
             SM_L_->y[i] = y[i];
         }
+        if (SM_S_) {
+            SM_S_->inc(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_GEN);
+            SM_S_->set(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_TICKS, System::Diagnostics::Stopwatch::GetTimestamp());
+        }
     } finally { Monitor::Exit(SM_L_->lockObject); }
 }
 
 void LiDAR::threadFunction(){
-    Console::WriteLine("[LiDAR] running — writing 361 points to SM and printing (x,y).");
+    Console::WriteLine("[LiDAR] running — writing 361 points to SM.");
     const int N = STANDARD_LIDAR_LENGTH; // 361
     array<double>^ x = gcnew array<double>(N);
     array<double>^ y = gcnew array<double>(N);
@@ -586,14 +1028,10 @@ void LiDAR::threadFunction(){
             x[i] = r * std::cos(rad);
             y[i] = r * std::sin(rad);
         }
-        writeScanToSharedMemory(x, y);
-
-        Console::WriteLine("LiDAR XY (361 pts):");
-        for (int i = 0; i < N; ++i)
-            Console::Write("( {0:F3}, {1:F3} ){2}", x[i], y[i], (i % 8 == 7) ? "\n" : "  ");
-        if ((N % 8) != 0) Console::WriteLine();
+        writeScanToSharedMemory(x, y);   // 可视化交给 Display（viewer socket）
+        if (SM_S_) { SM_S_->inc(SM_Stats::M_LIDAR, SM_Stats::C_LOOPS); SM_S_->inc(SM_Stats::M_LIDAR, SM_Stats::C_FRAMES_PARSED); }
 
-        Thread::Sleep(50); // ~20Hz
+        if (pollMs_ > 0) Thread::Sleep(pollMs_); // 默认 ~20Hz
     }
     Console::WriteLine("[LiDAR] thread exit.");
 }
@@ -604,12 +1042,13 @@ void LiDAR::threadFunction(){
 #pragma once
 #include <UGVModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 
 using namespace System;
 
 ref class VC : public UGVModule {
 public:
-    VC(SM_ThreadManagement^ sm_tm, SM_VehicleControl^ sm_vc);
+    VC(SM_ThreadManagement^ sm_tm, SM_VehicleControl^ sm_vc, SM_Stats^ sm_s);
 
     virtual error_state processSharedMemory() override;
     virtual bool getShutdownFlag() override;
@@ -617,6 +1056,7 @@ public:
 
 private:
     SM_VehicleControl^ SM_VC_;
+    SM_Stats^ SM_S_;
 };
 
 
@@ -625,9 +1065,10 @@ private:
 using namespace System;
 using namespace System::Threading;
 
-VC::VC(SM_ThreadManagement^ sm_tm, SM_VehicleControl^ sm_vc) {
+VC::VC(SM_ThreadManagement^ sm_tm, SM_VehicleControl^ sm_vc, SM_Stats^ sm_s) {
     SM_TM_ = sm_tm;
     SM_VC_ = sm_vc;
+    SM_S_  = sm_s;
 }
 
 error_state VC::processSharedMemory() {
@@ -646,6 +1087,7 @@ void VC::threadFunction() {
             try { SM_TM_->heartbeat |= bit_VC; }
             finally { Monitor::Exit(SM_TM_->lockObject); }
         }
+        if (SM_S_) SM_S_->inc(SM_Stats::M_VC, SM_Stats::C_LOOPS);
         Thread::Sleep(100); // 10 Hz 刷新
     }
     Console::WriteLine("[VC] thread exit.");
@@ -655,12 +1097,13 @@ void VC::threadFunction() {
 #pragma once
 #include <UGVModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 
 using namespace System;
 
 ref class Controller : public UGVModule {
 public:
-    Controller(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_GNSS^ sm_g, SM_VehicleControl^ sm_vc);
+    Controller(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_GNSS^ sm_g, SM_VehicleControl^ sm_vc, SM_Stats^ sm_s);
 
     virtual error_state processSharedMemory() override;
     virtual bool getShutdownFlag() override;
@@ -670,6 +1113,7 @@ private:
     SM_Lidar^          SM_L_;
     SM_GNSS^           SM_G_;
     SM_VehicleControl^ SM_VC_;
+    SM_Stats^          SM_S_;
 };
 
 
@@ -678,11 +1122,12 @@ private:
 using namespace System;
 using namespace System::Threading;
 
-Controller::Controller(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_GNSS^ sm_g, SM_VehicleControl^ sm_vc) {
+Controller::Controller(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_GNSS^ sm_g, SM_VehicleControl^ sm_vc, SM_Stats^ sm_s) {
     SM_TM_ = sm_tm;
     SM_L_  = sm_l;
     SM_G_  = sm_g;
     SM_VC_ = sm_vc;
+    SM_S_  = sm_s;
 }
 
 error_state Controller::processSharedMemory() {
@@ -701,6 +1146,7 @@ void Controller::threadFunction() {
             try { SM_TM_->heartbeat |= bit_CONTROLLER; }
             finally { Monitor::Exit(SM_TM_->lockObject); }
         }
+        if (SM_S_) SM_S_->inc(SM_Stats::M_CONTROLLER, SM_Stats::C_LOOPS);
         Thread::Sleep(80);
     }
     Console::WriteLine("[Controller] thread exit.");
@@ -713,12 +1159,13 @@ void Controller::threadFunction() {
 #pragma once
 #include <UGVModule.h>
 #include <SMObjects.h>
+#include "SMObjectsExt.h"
 
 using namespace System;
 
 ref class GNSS : public UGVModule {
 public:
-    GNSS(SM_ThreadManagement^ sm_tm, SM_GNSS^ sm_g);
+    GNSS(SM_ThreadManagement^ sm_tm, SM_GNSS^ sm_g, SM_Stats^ sm_s);
 
     virtual error_state processSharedMemory() override;
     virtual bool getShutdownFlag() override;
@@ -726,6 +1173,7 @@ public:
 
 private:
     SM_GNSS^ SM_G_;
+    SM_Stats^ SM_S_;
 };
 
 
@@ -733,9 +1181,10 @@ private:
 using namespace System;
 using namespace System::Threading;
 
-GNSS::GNSS(SM_ThreadManagement^ sm_tm, SM_GNSS^ sm_g) {
+GNSS::GNSS(SM_ThreadManagement^ sm_tm, SM_GNSS^ sm_g, SM_Stats^ sm_s) {
     SM_TM_ = sm_tm;
     SM_G_  = sm_g;
+    SM_S_  = sm_s;
 }
 
 error_state GNSS::processSharedMemory() {
@@ -756,6 +1205,7 @@ void GNSS::threadFunction() {
             try { SM_TM_->heartbeat |= bit_GNSS; }
             finally { Monitor::Exit(SM_TM_->lockObject); }
         }
+        if (SM_S_) SM_S_->inc(SM_Stats::M_GNSS, SM_Stats::C_LOOPS);
         Thread::Sleep(150); // 约 6~7 Hz 更新率
     }
     Console::WriteLine("[GNSS] thread exit.");
@@ -766,3 +1216,1147 @@ void GNSS::threadFunction() {
 
 
 
+// SMObjectsExt.h —— 课程 SMObjects.h 之外新增的共享内存
+#pragma once
+#include <SMObjects.h>
+
+using namespace System;
+using namespace System::Threading;
+
+#define bit_TRACKER 0b10000000      // SMObjects.h 里没占用的最高位
+
+// 障碍物列表（Tracker 写，CrashAvoidance / Controller 读）；单位 m, m/s，车体坐标
+ref class SM_Objects {
+public:
+    literal int MAX_OBJECTS = 256;
+
+    SM_Objects() {
+        id = gcnew array<int>(MAX_OBJECTS);
+        x  = gcnew array<double>(MAX_OBJECTS);
+        y  = gcnew array<double>(MAX_OBJECTS);
+        vx = gcnew array<double>(MAX_OBJECTS);
+        vy = gcnew array<double>(MAX_OBJECTS);
+    }
+
+    Object^ lockObject = gcnew Object();
+    int count = 0;                  // 有效条目数
+    array<int>^    id;
+    array<double>^ x;
+    array<double>^ y;
+    array<double>^ vx;
+    array<double>^ vy;
+};
+
+
+
+// 运行时计数器（TMM 创建，各模块只写自己那一行；TMM 定期导出到 "UGV_Stats" 共享内存页）
+// 每个计数器只有一个写者，Interlocked 只是为了 32 位进程下 64 位读写不撕裂
+ref class SM_Stats {
+public:
+    // 模块（行）
+    literal int M_TMM        = 0;
+    literal int M_LIDAR      = 1;
+    literal int M_DISPLAY    = 2;
+    literal int M_GNSS       = 3;
+    literal int M_CONTROLLER = 4;
+    literal int M_VC         = 5;
+    literal int M_CRASH      = 6;
+    literal int M_TRACKER    = 7;
+    literal int NUM_MODULES  = 8;
+
+    // 计数器（列）
+    literal int C_LOOPS          = 0;   // 主循环次数
+    literal int C_FRAMES_PARSED  = 1;   // 成功解析的帧
+    literal int C_FRAMES_DROPPED = 2;   // 丢弃的帧（DIST1 not found / count unresolved / carry 溢出 / 背压）
+    literal int C_BYTES_RX       = 3;   // 收到的字节
+    literal int C_PUBLISH_GEN    = 4;   // 写 SM 的代数（LiDAR: SM_Lidar；Tracker: SM_Objects）
+    literal int C_LIDAR_GEN_SEEN = 5;   // 读者最近一次读到的 SM_Lidar 代数；-1 = 当前不是读者
+    literal int C_PUBLISH_TICKS  = 6;   // 最近一次写 SM 的时刻（Stopwatch::GetTimestamp）
+    literal int NUM_COUNTERS     = 7;
+
+    // 托管数组的数据不保证 64 字节对齐，所以每行占 128 字节：
+    // 一行最多用 56 字节，相邻两行的有效数据至少隔 72 字节，无论起点在哪都不会落进同一条 64 字节 cache line。
+    // 前后各空一行，和数组头/相邻对象也隔开。
+    literal int STRIDE = 16;
+
+    SM_Stats() { counters = gcnew array<__int64>((NUM_MODULES + 2) * STRIDE); }
+
+    void    inc(int m, int c)             { Interlocked::Increment(counters[slot(m, c)]); }
+    void    add(int m, int c, __int64 v)  { Interlocked::Add(counters[slot(m, c)], v); }
+    void    set(int m, int c, __int64 v)  { Interlocked::Exchange(counters[slot(m, c)], v); }
+    __int64 get(int m, int c)             { return Interlocked::Read(counters[slot(m, c)]); }
+
+private:
+    static int slot(int m, int c) { return (m + 1) * STRIDE + c; }
+
+    array<__int64>^ counters;
+};
+
+
+
+
+// Tracker.h
+#pragma once
+#include <UGVModule.h>
+#include <SMObjects.h>
+#include "SMObjectsExt.h"
+
+using namespace System;
+
+// 每帧：断点法分簇（相邻 beam 距离跳变即断开，线性时间）→ 门限内全局最近邻关联 → 匀速 Kalman
+// 所有表在构造时分配，循环里不 gcnew
+ref class Tracker : public UGVModule {
+public:
+    Tracker(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_Objects^ sm_o, SM_Stats^ sm_s);
+
+    virtual error_state processSharedMemory() override;
+    virtual bool getShutdownFlag() override;
+    virtual void threadFunction() override;
+
+    // 单帧处理（dt 秒），也方便 Bench 直接调用
+    void step(array<double>^ x, array<double>^ y, double dt);
+
+private:
+    literal int    MAX_CLUSTERS = STANDARD_LIDAR_LENGTH;
+    literal int    MAX_TRACKS   = SM_Objects::MAX_OBJECTS;
+    literal int    MIN_POINTS   = 2;      // 少于此点数的簇视为噪声
+    literal int    MAX_MISSES   = 5;      // 连续丢失帧数上限
+    literal int    CONFIRM_HITS = 3;      // 命中几次后才发布
+    literal double BREAK_BASE   = 0.15;   // 断点门限 = BASE + RATIO * r  (m)
+    literal double BREAK_RATIO  = 0.03;
+    literal double GATE         = 9.21;   // 2 自由度 χ² 99%
+    literal double MEAS_VAR     = 0.01;   // 质心量测方差 (m²)
+    literal double ACCEL_VAR    = 1.0;    // 过程噪声：加速度方差 (m²/s⁴)
+
+    void cluster(array<double>^ x, array<double>^ y);
+    void predict(int t, double dt);
+    void update(int t, double zx, double zy);
+    double gateDistance(int t, double zx, double zy);
+    void spawn(double zx, double zy);
+    void publish();
+
+    SM_Lidar^   SM_L_;
+    SM_Objects^ SM_O_;
+    SM_Stats^   SM_S_;
+
+    // 扫描快照
+    array<double>^ sx_;
+    array<double>^ sy_;
+
+    // 簇表
+    int nClusters_;
+    array<double>^ cx_;
+    array<double>^ cy_;
+    array<bool>^   cUsed_;
+
+    // 轨迹表：状态 (x, y, vx, vy)，P 按 4x4 行主序存放
+    array<bool>^   active_;
+    array<int>^    tid_;
+    array<int>^    hits_;
+    array<int>^    misses_;
+    array<double>^ s_;      // 4 * MAX_TRACKS
+    array<double>^ P_;      // 16 * MAX_TRACKS
+    int nextId_;
+
+    // 关联候选：门内的 (轨迹, 簇) 对，按马氏距离排序后全局最近优先分配
+    array<double>^ pairD_;  // MAX_TRACKS * MAX_CLUSTERS
+    array<int>^    pairTC_; // t * MAX_CLUSTERS + c
+    array<bool>^   tUsed_;
+};
+
+
+
+// Tracker.cpp
+#include "Tracker.h"
+using namespace System;
+using namespace System::Threading;
+using namespace System::Diagnostics;
+
+Tracker::Tracker(SM_ThreadManagement^ sm_tm, SM_Lidar^ sm_l, SM_Objects^ sm_o, SM_Stats^ sm_s) {
+    SM_TM_ = sm_tm;
+    SM_L_  = sm_l;
+    SM_O_  = sm_o;
+    SM_S_  = sm_s;
+
+    sx_ = gcnew array<double>(STANDARD_LIDAR_LENGTH);
+    sy_ = gcnew array<double>(STANDARD_LIDAR_LENGTH);
+
+    nClusters_ = 0;
+    cx_    = gcnew array<double>(MAX_CLUSTERS);
+    cy_    = gcnew array<double>(MAX_CLUSTERS);
+    cUsed_ = gcnew array<bool>(MAX_CLUSTERS);
+
+    active_ = gcnew array<bool>(MAX_TRACKS);
+    tid_    = gcnew array<int>(MAX_TRACKS);
+    hits_   = gcnew array<int>(MAX_TRACKS);
+    misses_ = gcnew array<int>(MAX_TRACKS);
+    s_      = gcnew array<double>(4 * MAX_TRACKS);
+    P_      = gcnew array<double>(16 * MAX_TRACKS);
+    nextId_ = 1;
+
+    pairD_  = gcnew array<double>(MAX_TRACKS * MAX_CLUSTERS);
+    pairTC_ = gcnew array<int>(MAX_TRACKS * MAX_CLUSTERS);
+    tUsed_  = gcnew array<bool>(MAX_TRACKS);
+}
+
+error_state Tracker::processSharedMemory() {
+    return error_state::SUCCESS;
+}
+
+bool Tracker::getShutdownFlag() {
+    return (SM_TM_ != nullptr) && (SM_TM_->shutdown != 0);
+}
+
+// ===== 断点法分簇：相邻两束距离超过 BASE + RATIO*r 就断开 =====
+void Tracker::cluster(array<double>^ x, array<double>^ y) {
+    nClusters_ = 0;
+    double sumX = 0, sumY = 0;
+    int n = 0;
+    for (int i = 0; i <= x->Length; ++i) {
+        bool valid = false, brk = true;
+        if (i < x->Length) {
+            double r = Math::Sqrt(x[i] * x[i] + y[i] * y[i]);
+            valid = r > 0.01;                           // 0 = 无回波
+            if (valid && n > 0) {
+                double dx = x[i] - x[i - 1], dy = y[i] - y[i - 1];
+                double thr = BREAK_BASE + BREAK_RATIO * r;
+                brk = (dx * dx + dy * dy) > thr * thr;
+            }
+        }
+        if (brk && n > 0) {
+            if (n >= MIN_POINTS && nClusters_ < MAX_CLUSTERS) {
+                cx_[nClusters_] = sumX / n;
+                cy_[nClusters_] = sumY / n;
+                cUsed_[nClusters_] = false;
+                ++nClusters_;
+            }
+            sumX = sumY = 0; n = 0;
+        }
+        if (valid) { sumX += x[i]; sumY += y[i]; ++n; }
+    }
+}
+
+// ===== Kalman：匀速模型 =====
+void Tracker::predict(int t, double dt) {
+    interior_ptr<double> s = &s_[4 * t];
+    interior_ptr<double> P = &P_[16 * t];
+    s[0] += dt * s[2];
+    s[1] += dt * s[3];
+
+    // P = F P Fᵀ，F = [I dtI; 0 I]
+    for (int c = 0; c < 4; ++c) { P[0 * 4 + c] += dt * P[2 * 4 + c]; P[1 * 4 + c] += dt * P[3 * 4 + c]; }
+    for (int r = 0; r < 4; ++r) { P[r * 4 + 0] += dt * P[r * 4 + 2]; P[r * 4 + 1] += dt * P[r * 4 + 3]; }
+
+    // + Q（离散白噪声加速度，x/y 各自独立）
+    double q11 = ACCEL_VAR * dt * dt * dt * dt / 4, q12 = ACCEL_VAR * dt * dt * dt / 2, q22 = ACCEL_VAR * dt * dt;
+    for (int a = 0; a < 2; ++a) {
+        P[a * 4 + a]             += q11;
+        P[a * 4 + a + 2]         += q12;
+        P[(a + 2) * 4 + a]       += q12;
+        P[(a + 2) * 4 + a + 2]   += q22;
+    }
+}
+
+// 马氏距离²：νᵀ S⁻¹ ν，S = P[0:2,0:2] + R
+double Tracker::gateDistance(int t, double zx, double zy) {
+    interior_ptr<double> s = &s_[4 * t];
+    interior_ptr<double> P = &P_[16 * t];
+    double a = P[0] + MEAS_VAR, b = P[1], d = P[5] + MEAS_VAR;
+    double det = a * d - b * b;
+    if (det <= 0) return Double::MaxValue;
+    double nx = zx - s[0], ny = zy - s[1];
+    return (d * nx * nx - 2 * b * nx * ny + a * ny * ny) / det;
+}
+
+void Tracker::update(int t, double zx, double zy) {
+    interior_ptr<double> s = &s_[4 * t];
+    interior_ptr<double> P = &P_[16 * t];
+    double a = P[0] + MEAS_VAR, b = P[1], d = P[5] + MEAS_VAR;
+    double det = a * d - b * b;
+    double i00 = d / det, i01 = -b / det, i11 = a / det;     // S⁻¹
+    double nx = zx - s[0], ny = zy - s[1];
+
+    // K = P[:,0:2] S⁻¹（4x2）
+    double K[4][2];
+    for (int r = 0; r < 4; ++r) {
+        K[r][0] = P[r * 4 + 0] * i00 + P[r * 4 + 1] * i01;
+        K[r][1] = P[r * 4 + 0] * i01 + P[r * 4 + 1] * i11;
+    }
+    for (int r = 0; r < 4; ++r) s[r] += K[r][0] * nx + K[r][1] * ny;
+
+    // P = P - K P[0:2,:]
+    double top[2][4];
+    for (int c = 0; c < 4; ++c) { top[0][c] = P[c]; top[1][c] = P[4 + c]; }
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            P[r * 4 + c] -= K[r][0] * top[0][c] + K[r][1] * top[1][c];
+}
+
+void Tracker::spawn(double zx, double zy) {
+    for (int t = 0; t < MAX_TRACKS; ++t) {
+        if (active_[t]) continue;
+        active_[t] = true;
+        tid_[t]    = nextId_++;
+        hits_[t]   = 1;
+        misses_[t] = 0;
+        s_[4 * t + 0] = zx; s_[4 * t + 1] = zy; s_[4 * t + 2] = 0; s_[4 * t + 3] = 0;
+        Array::Clear(P_, 16 * t, 16);
+        P_[16 * t + 0] = P_[16 * t + 5] = MEAS_VAR;
+        P_[16 * t + 10] = P_[16 * t + 15] = 4.0;        // 初始速度未知 (±2 m/s)
+        return;
+    }
+    // 表满：丢弃新目标，已有轨迹优先
+}
+
+void Tracker::step(array<double>^ x, array<double>^ y, double dt) {
+    cluster(x, y);
+
+    // 预测，并收集所有门内的 (轨迹, 簇) 候选
+    int nPairs = 0;
+    for (int t = 0; t < MAX_TRACKS; ++t) {
+        tUsed_[t] = false;
+        if (!active_[t]) continue;
+        predict(t, dt);
+        for (int c = 0; c < nClusters_; ++c) {
+            double g = gateDistance(t, cx_[c], cy_[c]);
+            if (g >= GATE) continue;
+            pairD_[nPairs]  = g;
+            pairTC_[nPairs] = t * MAX_CLUSTERS + c;
+            ++nPairs;
+        }
+    }
+
+    // 全局最近邻：按距离从小到大分配，轨迹和簇都只用一次
+    // （按槽位顺序贪心会让前面的轨迹抢走后面轨迹的真实量测）
+    Array::Sort<double, int>(pairD_, pairTC_, 0, nPairs);
+    for (int k = 0; k < nPairs; ++k) {
+        int t = pairTC_[k] / MAX_CLUSTERS, c = pairTC_[k] % MAX_CLUSTERS;
+        if (tUsed_[t] || cUsed_[c]) continue;
+        tUsed_[t] = cUsed_[c] = true;
+        update(t, cx_[c], cy_[c]);
+        ++hits_[t];
+        misses_[t] = 0;
+    }
+
+    for (int t = 0; t < MAX_TRACKS; ++t)
+        if (active_[t] && !tUsed_[t] && ++misses_[t] > MAX_MISSES) active_[t] = false;
+
+    for (int c = 0; c < nClusters_; ++c)
+        if (!cUsed_[c]) spawn(cx_[c], cy_[c]);
+
+    publish();
+}
+
+void Tracker::publish() {
+    if (!SM_O_) return;
+    Monitor::Enter(SM_O_->lockObject);
+    try {
+        int n = 0;
+        for (int t = 0; t < MAX_TRACKS; ++t) {
+            if (!active_[t] || hits_[t] < CONFIRM_HITS) continue;
+            SM_O_->id[n] = tid_[t];
+            SM_O_->x[n]  = s_[4 * t + 0];
+            SM_O_->y[n]  = s_[4 * t + 1];
+            SM_O_->vx[n] = s_[4 * t + 2];
+            SM_O_->vy[n] = s_[4 * t + 3];
+            ++n;
+        }
+        SM_O_->count = n;
+        if (SM_S_) SM_S_->inc(SM_Stats::M_TRACKER, SM_Stats::C_PUBLISH_GEN);
+    }
+    finally { Monitor::Exit(SM_O_->lockObject); }
+}
+
+void Tracker::threadFunction() {
+    Console::WriteLine("[Tracker] running...");
+    __int64 lastTicks = 0;
+    while (!getShutdownFlag()) {
+        // 拷一份快照，锁外处理；和上一帧一样就跳过
+        bool fresh = false;
+        __int64 ticks = 0;
+        if (SM_L_) {
+            Monitor::Enter(SM_L_->lockObject);
+            try {
+                for (int i = 0; i < sx_->Length; ++i) {
+                    if (SM_L_->x[i] != sx_[i] || SM_L_->y[i] != sy_[i]) fresh = true;
+                    sx_[i] = SM_L_->x[i];
+                    sy_[i] = SM_L_->y[i];
+                }
+                if (SM_S_) {
+                    SM_S_->set(SM_Stats::M_TRACKER, SM_Stats::C_LIDAR_GEN_SEEN, SM_S_->get(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_GEN));
+                    // 与快照同一把锁下写入的发布时刻
+                    ticks = SM_S_->get(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_TICKS);
+                }
+            }
+            finally { Monitor::Exit(SM_L_->lockObject); }
+        }
+        if (fresh) {
+            // dt 取相邻两次发布的间隔，而不是本线程 10 ms 轮询的唤醒间隔；没有时间戳时按 25 Hz
+            double dt = (lastTicks > 0 && ticks > lastTicks)
+                ? (double)(ticks - lastTicks) / Stopwatch::Frequency : 0.04;
+            step(sx_, sy_, dt);
+            lastTicks = ticks;
+            if (SM_S_) SM_S_->inc(SM_Stats::M_TRACKER, SM_Stats::C_FRAMES_PARSED);
+        }
+        if (SM_S_) SM_S_->inc(SM_Stats::M_TRACKER, SM_Stats::C_LOOPS);
+
+        // 心跳
+        if (SM_TM_) {
+            Monitor::Enter(SM_TM_->lockObject);
+            try { SM_TM_->heartbeat |= bit_TRACKER; }
+            finally { Monitor::Exit(SM_TM_->lockObject); }
+        }
+        Thread::Sleep(10);  // LiDAR 25 Hz，这里轮询快一些
+    }
+    Console::WriteLine("[Tracker] thread exit.");
+}
+
+
+
+
+
+// ScanCodec.h —— 扫描压缩：量化距离 + beam/帧间差分 + zig-zag varint
+#pragma once
+#include <SMObjects.h>
+
+using namespace System;
+
+// 帧格式：
+//   [flags:1][quantMm:1][seq:varint][count:varint][payload...]
+//   flags bit0 = 关键帧。关键帧：q[0] 原值，之后 zigzag(q[i]-q[i-1])；
+//   差分帧：e[i] = q[i]-prev[i]，写 zigzag(e[i]-e[i-1])（运动时 e 沿 beam 平滑）
+// q = round(r_mm / quantMm)。解码端要求 seq 连续，否则等下一个关键帧。
+ref class ScanCodec {
+public:
+    literal Byte FLAG_KEY = 0x01;
+    literal int  HEADER_MAX = 2 + 5 + 5;
+
+    static unsigned int zigzag(int v)            { return ((unsigned int)v << 1) ^ (unsigned int)(v >> 31); }
+    static int          unzigzag(unsigned int u) { return (int)(u >> 1) ^ -(int)(u & 1); }
+
+    static void writeVarint(array<Byte>^ buf, int% pos, unsigned int v);
+    // 越界返回 false
+    static bool readVarint(array<Byte>^ buf, int end, int% pos, unsigned int% v);
+
+    // 最坏情况：每个值 5 字节
+    static int maxEncodedSize(int beams) { return HEADER_MAX + 5 * beams; }
+};
+
+ref class ScanEncoder {
+public:
+    ScanEncoder(int beams, int quantMm, int keyInterval);
+
+    // 编码一帧 ranges(mm)，返回写入 out 的字节数；out 至少 maxEncodedSize(beams)
+    int encode(array<int>^ ranges, array<Byte>^ out);
+    // 下一帧强制关键帧（例如接收端重连）
+    void reset() { sinceKey_ = keyInterval_; }
+
+private:
+    array<int>^ prev_;      // 上一帧量化值
+    int quant_;
+    int keyInterval_;
+    int sinceKey_;
+    int seq_;
+};
+
+ref class ScanDecoder {
+public:
+    ScanDecoder(int beams);
+
+    // 解出 ranges(mm)；格式错误或缺少参考帧返回 false
+    bool decode(array<Byte>^ in, int length, array<int>^ ranges);
+    // 解出后经 LiDAR 的 trig 表还原 x/y(m)
+    bool decodeXY(array<Byte>^ in, int length, array<double>^ x, array<double>^ y);
+
+private:
+    array<int>^ prev_;
+    array<int>^ mm_;
+    bool haveRef_;
+    int seq_;
+    int refQuant_;      // prev_ 所用的量化步长；差分帧必须与之相同
+};
+
+
+
+// ScanCodec.cpp
+#include "ScanCodec.h"
+#include "LiDAR.h"
+using namespace System;
+
+void ScanCodec::writeVarint(array<Byte>^ buf, int% pos, unsigned int v) {
+    while (v >= 0x80) {
+        buf[pos++] = (Byte)(v | 0x80);
+        v >>= 7;
+    }
+    buf[pos++] = (Byte)v;
+}
+
+bool ScanCodec::readVarint(array<Byte>^ buf, int end, int% pos, unsigned int% v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos >= end) return false;
+        Byte b = buf[pos++];
+        v |= (unsigned int)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+// ===== encoder =====
+ScanEncoder::ScanEncoder(int beams, int quantMm, int keyInterval)
+    : quant_(Math::Max(1, Math::Min(quantMm, 255))), keyInterval_(Math::Max(1, keyInterval)),
+      sinceKey_(keyInterval_), seq_(0) {
+    prev_ = gcnew array<int>(beams);
+}
+
+int ScanEncoder::encode(array<int>^ ranges, array<Byte>^ out) {
+    int n = prev_->Length;
+    bool key = (sinceKey_ >= keyInterval_);
+    int pos = 0;
+    out[pos++] = key ? ScanCodec::FLAG_KEY : (Byte)0;
+    out[pos++] = (Byte)quant_;
+    ScanCodec::writeVarint(out, pos, (unsigned int)(seq_++ & 0xFFFF));
+    ScanCodec::writeVarint(out, pos, (unsigned int)n);
+
+    int half = quant_ / 2;
+    int last = 0;       // 关键帧：上一束 q；差分帧：上一束 e
+    for (int i = 0; i < n; ++i) {
+        int q = (ranges[i] + half) / quant_;
+        int v = key ? q : q - prev_[i];
+        ScanCodec::writeVarint(out, pos, ScanCodec::zigzag(v - last));
+        last = v;
+        prev_[i] = q;
+    }
+    sinceKey_ = key ? 1 : sinceKey_ + 1;
+    return pos;
+}
+
+// ===== decoder =====
+ScanDecoder::ScanDecoder(int beams) : haveRef_(false), seq_(0), refQuant_(0) {
+    prev_ = gcnew array<int>(beams);
+    mm_   = gcnew array<int>(beams);
+}
+
+bool ScanDecoder::decode(array<Byte>^ in, int length, array<int>^ ranges) {
+    if (length < 2) return false;
+    int pos = 0;
+    bool key  = (in[pos++] & ScanCodec::FLAG_KEY) != 0;
+    int quant = in[pos++];
+    unsigned int seq = 0, count = 0;
+    if (quant == 0) return false;
+    if (!ScanCodec::readVarint(in, length, pos, seq)) return false;
+    if (!ScanCodec::readVarint(in, length, pos, count)) return false;
+    if ((int)count != prev_->Length || ranges->Length < (int)count) return false;
+    // 差分帧必须紧接参考帧，且量化步长一致（否则 prev_ 的单位不对）
+    if (!key && (!haveRef_ || (int)seq != ((seq_ + 1) & 0xFFFF) || quant != refQuant_)) {
+        haveRef_ = false;
+        return false;
+    }
+
+    int last = 0;
+    for (int i = 0; i < (int)count; ++i) {
+        unsigned int u = 0;
+        if (!ScanCodec::readVarint(in, length, pos, u)) { haveRef_ = false; return false; }
+        int v = last + ScanCodec::unzigzag(u);
+        last = v;
+        int q = key ? v : prev_[i] + v;
+        prev_[i]  = q;
+        ranges[i] = q * quant;
+    }
+    haveRef_ = true;
+    seq_ = (int)seq;
+    refQuant_ = quant;
+    return true;
+}
+
+bool ScanDecoder::decodeXY(array<Byte>^ in, int length, array<double>^ x, array<double>^ y) {
+    if (!decode(in, length, mm_)) return false;
+    LiDAR::polarToCartesian(mm_, x, y);
+    return true;
+}
+
+
+
+
+
+// Bench.h —— 独立工程 UGVBench（与主工程共用 LiDAR / TMM 等源文件）
+#pragma once
+#include "LiDAR.h"
+#include "TMM.h"
+#include "ScanCodec.h"
+#include "Tracker.h"
+
+using namespace System;
+using namespace System::Threading;
+using namespace System::Net;
+using namespace System::Net::Sockets;
+using namespace System::Collections::Generic;
+
+// 模拟器替身：监听 127.0.0.1:port，认证后每收到一个请求(ETX)回一帧 LMDscandata
+// r[0] = 1000 + seq (mm)，SM 侧据此反查帧号，算端到端延迟
+ref class SimulatorStandIn {
+public:
+    literal int SEQ_WRAP = 4000;
+
+    SimulatorStandIn(int port);
+    void start();
+    void stop();
+    void threadFunction();
+
+    static String^ buildTelegram(int seq);          // 不含 STX/ETX
+    static array<Byte>^ frameBytes(String^ telegram);  // 加上 STX/ETX
+
+    array<__int64>^ sendTicks;                      // 按 seq % SEQ_WRAP 记录的发送时刻
+    int framesSent;
+
+private:
+    int port_;
+    TcpListener^ listener_;
+    TcpClient^ client_;
+    Thread^ th_;
+};
+
+// SM 读者：不停地在锁内拷贝 x/y，统计读取次数
+ref class SMReader {
+public:
+    SMReader(SM_Lidar^ sm) : SM_L_(sm), stop(0), reads(0) {}
+    void run();
+    int stop;
+    __int64 reads;
+private:
+    SM_Lidar^ SM_L_;
+};
+
+// 延迟探针：轮询 SM_Lidar，x[0] 变了就记一个延迟样本
+// 只负责延迟；LiDAR 不限速时两次采样之间可能发布多帧，帧数以发布端 C_PUBLISH_GEN 为准
+ref class LatencyProbe {
+public:
+    LatencyProbe(SM_Lidar^ sm, array<__int64>^ sendTicks, int capacity);
+    void run();
+    int stop;
+    int count;
+    array<double>^ samplesMs;
+private:
+    SM_Lidar^ SM_L_;
+    array<__int64>^ sendTicks_;
+};
+
+ref class LidarBench {
+public:
+    static int run(array<String^>^ args);
+private:
+    static void benchFraming(List<String^>^ out);
+    static void benchParse(List<String^>^ out);
+    static void benchPolar(List<String^>^ out);
+    static void benchSMContention(List<String^>^ out);
+    static void benchCodec(List<String^>^ out);
+    static void benchTracker(List<String^>^ out);
+    static String^ benchPipeline(int seconds);
+    static String^ entry(String^ name, System::Diagnostics::Stopwatch^ sw, int ops, bool ok);
+    static double percentile(array<double>^ sorted, int n, double q);
+};
+
+
+
+// Bench.cpp
+#include "Bench.h"
+using namespace System;
+using namespace System::IO;
+using namespace System::Text;
+using namespace System::Threading;
+using namespace System::Diagnostics;
+using namespace System::Globalization;
+using namespace System::Net;
+using namespace System::Net::Sockets;
+using namespace System::Collections::Generic;
+
+// ===== 模拟器替身 =====
+SimulatorStandIn::SimulatorStandIn(int port) : port_(port), framesSent(0) {
+    sendTicks = gcnew array<__int64>(SEQ_WRAP);
+}
+
+String^ SimulatorStandIn::buildTelegram(int seq) {
+    // 字段布局参照 LMS151：DIST1 之后 scale/offset/起始角/步距，再是点数 169(=361)
+    StringBuilder^ sb = gcnew StringBuilder(2600);
+    sb->Append("sRA LMDscandata 1 1 89A27F 0 0 343 347 27477BA9 2747813B 0 0 7 0 0 1388 168 0 1 DIST1 3F800000 00000000 0 1388 169");
+    for (int i = 0; i < STANDARD_LIDAR_LENGTH; ++i) {
+        int r_mm = (i == 0) ? 1000 + (seq % SEQ_WRAP) : 3000 + (i * 37) % 500;
+        sb->Append(' ')->Append(r_mm.ToString("X"));
+    }
+    sb->Append(" 0 0 0 0 0 0");
+    return sb->ToString();
+}
+
+array<Byte>^ SimulatorStandIn::frameBytes(String^ telegram) {
+    array<Byte>^ body = Encoding::ASCII->GetBytes(telegram);
+    array<Byte>^ out = gcnew array<Byte>(body->Length + 2);
+    out[0] = 0x02;                                 // STX
+    Array::Copy(body, 0, out, 1, body->Length);
+    out[out->Length - 1] = 0x03;                   // ETX
+    return out;
+}
+
+void SimulatorStandIn::start() {
+    listener_ = gcnew TcpListener(IPAddress::Loopback, port_);
+    listener_->Start();
+    th_ = gcnew Thread(gcnew ThreadStart(this, &SimulatorStandIn::threadFunction));
+    th_->IsBackground = true;                      // LiDAR 不主动断开，靠 stop() 关 socket
+    th_->Start();
+}
+
+void SimulatorStandIn::stop() {
+    listener_->Stop();
+    if (client_) client_->Close();
+    th_->Join();
+}
+
+void SimulatorStandIn::threadFunction() {
+    try { client_ = listener_->AcceptTcpClient(); }
+    catch (SocketException^) { return; }
+    NetworkStream^ s = client_->GetStream();
+    array<Byte>^ buf = gcnew array<Byte>(256);
+
+    try {
+        // 认证：收 zID 行，回 OK
+        if (s->Read(buf, 0, buf->Length) <= 0) return;
+        array<Byte>^ ok = Encoding::ASCII->GetBytes("OK\n");
+        s->Write(ok, 0, ok->Length);
+
+        int seq = 0;
+        for (;;) {
+            int m = s->Read(buf, 0, buf->Length);
+            if (m <= 0) break;
+            for (int k = 0; k < m; ++k) {
+                if (buf[k] != 0x03) continue;      // 每个 ETX 对应一个请求
+                array<Byte>^ out = frameBytes(buildTelegram(seq));
+                sendTicks[seq % SEQ_WRAP] = Stopwatch::GetTimestamp();
+                s->Write(out, 0, out->Length);
+                framesSent = ++seq;
+            }
+        }
+    }
+    catch (Exception^) { /* stop() 关闭连接 */ }
+}
+
+// ===== SM 读者 =====
+void SMReader::run() {
+    array<double>^ bx = gcnew array<double>(STANDARD_LIDAR_LENGTH);
+    array<double>^ by = gcnew array<double>(STANDARD_LIDAR_LENGTH);
+    while (Thread::VolatileRead(stop) == 0) {
+        Monitor::Enter(SM_L_->lockObject);
+        try {
+            Array::Copy(SM_L_->x, bx, bx->Length);
+            Array::Copy(SM_L_->y, by, by->Length);
+        }
+        finally { Monitor::Exit(SM_L_->lockObject); }
+        ++reads;
+    }
+}
+
+// ===== 延迟探针 =====
+LatencyProbe::LatencyProbe(SM_Lidar^ sm, array<__int64>^ sendTicks, int capacity)
+    : SM_L_(sm), sendTicks_(sendTicks), stop(0), count(0) {
+    samplesMs = gcnew array<double>(capacity);
+}
+
+void LatencyProbe::run() {
+    int lastMm = -1;
+    while (Thread::VolatileRead(stop) == 0) {
+        // 不拿锁：x[0] 是 LiDAR 拷贝循环写的第一个值，只用来检测新帧到达，
+        // 这样探针不会和写者抢锁、把测到的延迟抬高
+        double x0 = Thread::VolatileRead(SM_L_->x[0]);
+        __int64 now = Stopwatch::GetTimestamp();
+
+        int mm = (int)Math::Round(x0 * 1000.0);
+        if (mm >= 1000 && mm < 1000 + SimulatorStandIn::SEQ_WRAP && mm != lastMm) {
+            lastMm = mm;
+            __int64 sent = sendTicks_[(mm - 1000) % SimulatorStandIn::SEQ_WRAP];
+            if (sent > 0 && count < samplesMs->Length)
+                samplesMs[count++] = (now - sent) * 1000.0 / Stopwatch::Frequency;
+        }
+        Thread::Yield();
+    }
+}
+
+// ===== micro benchmarks =====
+String^ LidarBench::entry(String^ name, Stopwatch^ sw, int ops, bool ok) {
+    double ns = sw->Elapsed.TotalMilliseconds * 1e6 / ops;
+    return String::Format(CultureInfo::InvariantCulture,
+        "{{\"name\":\"{0}\",\"ops\":{1},\"ns_per_op\":{2:F1},\"ops_per_sec\":{3:F0},\"ok\":{4}}}",
+        name, ops, ns, 1e9 / ns, ok ? (String^)"true" : "false");
+}
+
+void LidarBench::benchFraming(List<String^>^ out) {
+    String^ tel = Encoding::ASCII->GetString(SimulatorStandIn::frameBytes(SimulatorStandIn::buildTelegram(0)));
+    const int ITERS = 20000;
+    String^ frame = nullptr;
+
+    // 半包：每帧拆成 3 段到达
+    int third = tel->Length / 3;
+    array<String^>^ parts = gcnew array<String^>{
+        tel->Substring(0, third), tel->Substring(third, third), tel->Substring(2 * third) };
+    String^ carry = "";
+    int got = 0;
+    Stopwatch^ sw = Stopwatch::StartNew();
+    for (int it = 0; it < ITERS; ++it) {
+        for (int p = 0; p < parts->Length; ++p) {
+            carry += parts[p];
+            while (LiDAR::extractFrame(carry, frame)) ++got;
+        }
+    }
+    sw->Stop();
+    out->Add(entry("framing_partial", sw, ITERS, got == ITERS));
+
+    // 粘包：两帧合在一个 chunk 里
+    String^ two = tel + tel;
+    carry = "";
+    got = 0;
+    sw = Stopwatch::StartNew();
+    for (int it = 0; it < ITERS / 2; ++it) {
+        carry += two;
+        while (LiDAR::extractFrame(carry, frame)) ++got;
+    }
+    sw->Stop();
+    out->Add(entry("framing_coalesced", sw, ITERS, got == ITERS));
+}
+
+void LidarBench::benchParse(List<String^>^ out) {
+    String^ tel = SimulatorStandIn::buildTelegram(7);
+    array<int>^ ranges = gcnew array<int>(STANDARD_LIDAR_LENGTH);
+    const int ITERS = 5000;
+    bool ok = true;
+    int count = 0, tokens = 0;
+    Stopwatch^ sw = Stopwatch::StartNew();
+    for (int it = 0; it < ITERS; ++it)
+        ok &= (LiDAR::parseDist1(tel, ranges, count, tokens) == LiDAR::ParseResult::OK);
+    sw->Stop();
+    out->Add(entry("parse_dist1", sw, ITERS, ok && ranges[0] == 1007));
+}
+
+void LidarBench::benchPolar(List<String^>^ out) {
+    const int N = STANDARD_LIDAR_LENGTH;
+    array<int>^ ranges = gcnew array<int>(N);
+    array<double>^ x = gcnew array<double>(N);
+    array<double>^ y = gcnew array<double>(N);
+    for (int i = 0; i < N; ++i) ranges[i] = 3000 + (i * 37) % 500;
+    const int ITERS = 100000;
+    Stopwatch^ sw = Stopwatch::StartNew();
+    for (int it = 0; it < ITERS; ++it) LiDAR::polarToCartesian(ranges, x, y);
+    sw->Stop();
+    out->Add(entry("polar_to_cartesian", sw, ITERS, Math::Abs(x[0] - 3.0) < 1e-9));
+}
+
+void LidarBench::benchSMContention(List<String^>^ out) {
+    const int N = STANDARD_LIDAR_LENGTH;
+    const int PUBLISHES = 20000;
+    array<double>^ x = gcnew array<double>(N);
+    array<double>^ y = gcnew array<double>(N);
+    array<int>^ readerCounts = gcnew array<int>{ 0, 1, 2, 4, 8 };
+
+    for each (int nReaders in readerCounts) {
+        SM_Lidar^ sm = gcnew SM_Lidar();
+        LiDAR^ lidar = gcnew LiDAR(nullptr, sm, nullptr);
+        array<SMReader^>^ readers = gcnew array<SMReader^>(nReaders);
+        array<Thread^>^ threads = gcnew array<Thread^>(nReaders);
+        for (int r = 0; r < nReaders; ++r) {
+            readers[r] = gcnew SMReader(sm);
+            threads[r] = gcnew Thread(gcnew ThreadStart(readers[r], &SMReader::run));
+            threads[r]->Start();
+        }
+
+        Stopwatch^ sw = Stopwatch::StartNew();
+        for (int p = 0; p < PUBLISHES; ++p) lidar->writeScanToSharedMemory(x, y);
+        sw->Stop();
+
+        __int64 reads = 0;
+        for (int r = 0; r < nReaders; ++r) {
+            Thread::VolatileWrite(readers[r]->stop, 1);
+            threads[r]->Join();
+            reads += readers[r]->reads;
+        }
+
+        String^ e = entry(String::Format("sm_publish_{0}_readers", nReaders), sw, PUBLISHES, true);
+        // 追加读者吞吐
+        out->Add(e->Insert(e->Length - 1, String::Format(CultureInfo::InvariantCulture,
+            ",\"reader_reads_per_sec\":{0:F0}", reads / sw->Elapsed.TotalSeconds)));
+    }
+}
+
+// 编解码：场景缓慢变化（模拟车辆前进），1mm 量化，每 25 帧一个关键帧
+void LidarBench::benchCodec(List<String^>^ out) {
+    const int N = STANDARD_LIDAR_LENGTH;
+    const int FRAMES = 2000;
+    array<array<int>^>^ scans = gcnew array<array<int>^>(FRAMES);
+    for (int f = 0; f < FRAMES; ++f) {
+        scans[f] = gcnew array<int>(N);
+        for (int i = 0; i < N; ++i)
+            scans[f][i] = 3000 + (int)(800.0 * Math::Sin(i * 0.03 + f * 0.01)) + ((i * 7 + f * 13) % 5);
+    }
+
+    ScanEncoder^ enc = gcnew ScanEncoder(N, 1, 25);
+    ScanDecoder^ dec = gcnew ScanDecoder(N);
+    array<array<Byte>^>^ packets = gcnew array<array<Byte>^>(FRAMES);
+    array<int>^ lengths = gcnew array<int>(FRAMES);
+    for (int f = 0; f < FRAMES; ++f) packets[f] = gcnew array<Byte>(ScanCodec::maxEncodedSize(N));
+
+    __int64 bytes = 0;
+    Stopwatch^ sw = Stopwatch::StartNew();
+    for (int f = 0; f < FRAMES; ++f) {
+        lengths[f] = enc->encode(scans[f], packets[f]);
+        bytes += lengths[f];
+    }
+    sw->Stop();
+    double rawBytes = 2.0 * N * sizeof(double);
+    String^ e = entry("codec_encode", sw, FRAMES, true);
+    out->Add(e->Insert(e->Length - 1, String::Format(CultureInfo::InvariantCulture,
+        ",\"bytes_per_frame\":{0:F1},\"ratio_vs_xy\":{1:F2}", (double)bytes / FRAMES, rawBytes * FRAMES / bytes)));
+
+    array<int>^ back = gcnew array<int>(N);
+    bool ok = true;
+    sw = Stopwatch::StartNew();
+    for (int f = 0; f < FRAMES; ++f) {
+        ok &= dec->decode(packets[f], lengths[f], back);
+    }
+    sw->Stop();
+    for (int i = 0; i < N; ++i) ok &= (back[i] == scans[FRAMES - 1][i]);   // 1mm 量化应无损
+    out->Add(entry("codec_decode", sw, FRAMES, ok));
+
+    array<double>^ x = gcnew array<double>(N);
+    array<double>^ y = gcnew array<double>(N);
+    dec = gcnew ScanDecoder(N);
+    ok = true;
+    sw = Stopwatch::StartNew();
+    for (int f = 0; f < FRAMES; ++f) ok &= dec->decodeXY(packets[f], lengths[f], x, y);
+    sw->Stop();
+    // 和原始 ranges 直接走 polarToCartesian 的结果对比（1mm 量化无损，应逐点相等）
+    array<double>^ refX = gcnew array<double>(N);
+    array<double>^ refY = gcnew array<double>(N);
+    LiDAR::polarToCartesian(scans[FRAMES - 1], refX, refY);
+    for (int i = 0; i < N; ++i) ok &= (Math::Abs(x[i] - refX[i]) < 1e-9 && Math::Abs(y[i] - refY[i]) < 1e-9);
+    out->Add(entry("codec_decode_xy", sw, FRAMES, ok));
+}
+
+// 跟踪：每两束一个目标（约 180 个），远近交替保证断点，整体缓慢后退
+void LidarBench::benchTracker(List<String^>^ out) {
+    const int N = STANDARD_LIDAR_LENGTH;
+    const int FRAMES = 1000;
+    SM_Objects^ sm = gcnew SM_Objects();
+    Tracker^ tracker = gcnew Tracker(nullptr, nullptr, sm, nullptr);
+    array<int>^ ranges = gcnew array<int>(N);
+    array<double>^ x = gcnew array<double>(N);
+    array<double>^ y = gcnew array<double>(N);
+
+    // 场景：所有目标每帧沿径向外移 4 mm，dt = 0.04 s → 径向速度 0.1 m/s
+    const int CHECK = 10;               // 收敛后检查最后几帧
+    const double V_RADIAL = 0.1, V_TOL = 0.02;
+    array<int>^ ids = gcnew array<int>(SM_Objects::MAX_OBJECTS);
+    int nIds = -1;
+    bool idsStable = true;
+    double maxVErr = 0;
+
+    Stopwatch^ sw = gcnew Stopwatch();
+    for (int f = 0; f < FRAMES; ++f) {
+        for (int i = 0; i < N; ++i) ranges[i] = (((i / 2) % 2) ? 6000 : 2000) + 4 * f;
+        LiDAR::polarToCartesian(ranges, x, y);
+        sw->Start();
+        tracker->step(x, y, 0.04);
+        sw->Stop();
+
+        if (f < FRAMES - CHECK) continue;
+        for (int k = 0; k < sm->count; ++k) {
+            double r = Math::Sqrt(sm->x[k] * sm->x[k] + sm->y[k] * sm->y[k]);
+            double vr = (sm->x[k] * sm->vx[k] + sm->y[k] * sm->vy[k]) / r;
+            double vt = (sm->x[k] * sm->vy[k] - sm->y[k] * sm->vx[k]) / r;
+            maxVErr = Math::Max(maxVErr, Math::Max(Math::Abs(vr - V_RADIAL), Math::Abs(vt)));
+        }
+        // 轨迹槽位不变时发布顺序也不变，逐项比较即可
+        if (nIds < 0) {
+            nIds = sm->count;
+            Array::Copy(sm->id, ids, nIds);
+        } else if (sm->count != nIds) {
+            idsStable = false;
+        } else {
+            for (int k = 0; k < nIds; ++k) if (sm->id[k] != ids[k]) idsStable = false;
+        }
+    }
+    bool ok = sm->count > 100 && maxVErr < V_TOL && idsStable;
+    String^ e = entry("tracker_step", sw, FRAMES, ok);
+    out->Add(e->Insert(e->Length - 1, String::Format(CultureInfo::InvariantCulture,
+        ",\"objects\":{0},\"max_vel_err\":{1:F4},\"ids_stable\":{2}",
+        sm->count, maxVErr, idsStable ? (String^)"true" : "false")));
+}
+
+// sorted 的前 n 个已升序
+double LidarBench::percentile(array<double>^ sorted, int n, double q) {
+    return n > 0 ? sorted[Math::Min(n - 1, (int)(q * (n - 1) + 0.5))] : 0.0;
+}
+
+// ===== macro：TMM 全链路对着模拟器替身跑 =====
+String^ LidarBench::benchPipeline(int seconds) {
+    SimulatorStandIn^ sim = gcnew SimulatorStandIn(23000);
+    sim->start();
+
+    // LiDAR 不休眠、不逐帧打印：scans_per_sec 反映解析/发布链路，而不是 40 ms 节拍或控制台 I/O
+    ThreadManagement^ tmm = gcnew ThreadManagement();
+    tmm->setLidarPollInterval(0);
+    tmm->setLidarLogEvery(0);
+    Thread^ thTM = gcnew Thread(gcnew ThreadStart(tmm, &ThreadManagement::threadFunction));
+    thTM->Start();
+    while (tmm->getLidarSM() == nullptr || tmm->getStatsSM() == nullptr) Thread::Sleep(1);
+    SM_Stats^ stats = tmm->getStatsSM();
+
+    LatencyProbe^ probe = gcnew LatencyProbe(tmm->getLidarSM(), sim->sendTicks, 1 << 16);
+    Thread^ thP = gcnew Thread(gcnew ThreadStart(probe, &LatencyProbe::run));
+    Stopwatch^ sw = Stopwatch::StartNew();
+    __int64 gen0 = stats->get(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_GEN);
+    thP->Start();
+    Thread::Sleep(seconds * 1000);
+    __int64 published = stats->get(SM_Stats::M_LIDAR, SM_Stats::C_PUBLISH_GEN) - gen0;
+    double elapsed = sw->Elapsed.TotalSeconds;
+    Thread::VolatileWrite(probe->stop, 1);
+    thP->Join();
+    sw->Stop();
+
+    tmm->shutdownModules();
+    thTM->Join();
+    sim->stop();
+
+    int n = probe->count;
+    array<double>^ s = probe->samplesMs;
+    Array::Sort(s, 0, n);
+    // 一帧都没发布（连不上/认证失败/端口被占）或没有延迟样本 → ok:false
+    bool ok = published > 0 && n > 0;
+    return String::Format(CultureInfo::InvariantCulture,
+        "{{\"seconds\":{0:F2},\"frames_sent\":{1},\"frames_published\":{2},\"scans_per_sec\":{3:F2},"
+        "\"latency_samples\":{4},\"latency_ms\":{{\"p50\":{5:F3},\"p90\":{6:F3},\"p99\":{7:F3},\"max\":{8:F3}}},\"ok\":{9}}}",
+        elapsed, sim->framesSent, published, published / elapsed, n,
+        percentile(s, n, 0.50), percentile(s, n, 0.90), percentile(s, n, 0.99), percentile(s, n, 1.0),
+        ok ? (String^)"true" : "false");
+}
+
+int LidarBench::run(array<String^>^ args) {
+    String^ path = (args->Length > 0) ? args[0] : "bench_output.json";
+    int seconds  = (args->Length > 1) ? Int32::Parse(args[1]) : 5;
+
+    List<String^>^ micro = gcnew List<String^>();
+    benchFraming(micro);
+    benchParse(micro);
+    benchPolar(micro);
+    benchSMContention(micro);
+    benchCodec(micro);
+    benchTracker(micro);
+    String^ pipeline = benchPipeline(seconds);
+
+    String^ json = String::Format("{{\"timestamp\":\"{0}\",\"micro\":[{1}],\"pipeline\":{2}}}",
+        DateTime::UtcNow.ToString("o"), String::Join(",", micro), pipeline);
+    File::WriteAllText(path, json);
+    Console::WriteLine("[Bench] results -> {0}", path);
+
+    // 任一正确性检查失败 → 非 0，供回归门禁使用
+    for each (String^ e in micro) {
+        if (e->Contains("\"ok\":false")) {
+            Console::WriteLine("[Bench] check failed: {0}", e);
+            return 2;
+        }
+    }
+    if (pipeline->Contains("\"ok\":false")) {
+        Console::WriteLine("[Bench] pipeline check failed: {0}", pipeline);
+        return 2;
+    }
+    return 0;
+}
+
+// UGVBench 的入口：UGVBench.exe [out.json] [pipeline 秒数]；有检查失败时返回 2
+int main(array<System::String ^> ^ args)
+{
+    return LidarBench::run(args);
+}
+
+
+
+
+
+// StatsCli.cpp —— 独立工程 UGVStats：只读轮询 TMM 导出的 "UGV_Stats" 页
+// 用法：UGVStats.exe [间隔 ms，默认 200] [--once]
+#include <SMObjects.h>
+#include "SMObjectsExt.h"
+#include "TMM.h"
+using namespace System;
+using namespace System::Threading;
+using namespace System::IO::MemoryMappedFiles;
+
+ref class StatsCli {
+public:
+    static int run(array<String^>^ args);
+private:
+    // seqlock 读：拿到一致快照返回 true
+    static bool readSnapshot(MemoryMappedViewAccessor^ view, array<__int64>^ out);
+};
+
+bool StatsCli::readSnapshot(MemoryMappedViewAccessor^ view, array<__int64>^ out) {
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        __int64 s1 = view->ReadInt64(8);
+        if (s1 & 1) { Thread::SpinWait(50); continue; }
+        Thread::MemoryBarrier();
+        for (int i = 0; i < out->Length; ++i) out[i] = view->ReadInt64(i * 8);
+        Thread::MemoryBarrier();
+        if (view->ReadInt64(8) == s1) return true;
+    }
+    return false;
+}
+
+int StatsCli::run(array<String^>^ args) {
+    int intervalMs = (args->Length > 0 && args[0] != "--once") ? Int32::Parse(args[0]) : 200;
+    bool once = Array::IndexOf(args, "--once") >= 0;
+
+    MemoryMappedFile^ map = nullptr;
+    try { map = MemoryMappedFile::OpenExisting(ThreadManagement::STATS_MAP_NAME, MemoryMappedFileRights::Read); }
+    catch (Exception^) { Console::WriteLine("[UGVStats] '{0}' not found — is TMM running?", ThreadManagement::STATS_MAP_NAME); return 1; }
+    MemoryMappedViewAccessor^ view = map->CreateViewAccessor(0, ThreadManagement::STATS_SIZE, MemoryMappedFileAccess::Read);
+
+    array<String^>^ names = gcnew array<String^>{ "TMM", "LiDAR", "Display", "GNSS", "Controller", "VC", "CrashAvoid", "Tracker" };
+    array<int>^ bits = gcnew array<int>{ 0, bit_LIDAR, bit_DISPLAY, bit_GNSS, bit_CONTROLLER, bit_VC, bit_CRASHAVOIDANCE, bit_TRACKER };
+    const int M = SM_Stats::NUM_MODULES, C = SM_Stats::NUM_COUNTERS;
+    array<__int64>^ cur  = gcnew array<__int64>(ThreadManagement::STATS_SIZE / 8);
+    array<__int64>^ prev = gcnew array<__int64>(cur->Length);
+    bool havePrev = false;
+
+    for (;;) {
+        if (!readSnapshot(view, cur) || cur[0] != ThreadManagement::STATS_MAGIC) {
+            Console::WriteLine("[UGVStats] no consistent snapshot.");
+        }
+        else if (!havePrev || cur[2] != prev[2]) {
+            double dt = havePrev ? (cur[2] - prev[2]) / (double)TimeSpan::TicksPerSecond : 0;
+            int hb = (int)cur[3];
+            Console::WriteLine("{0:HH:mm:ss.fff}  heartbeat=0x{1:X2}", DateTime(cur[2], DateTimeKind::Utc).ToLocalTime(), hb);
+            Console::WriteLine("  {0,-11}{1,4}{2,10}{3,10}{4,9}{5,11}{6,10}{7,6}",
+                "module", "hb", "loops/s", "parsed", "dropped", "rx B/s", "pub gen", "lag");
+            for (int m = 0; m < M; ++m) {
+                int base = ThreadManagement::STATS_HEADER / 8 + m * C;
+                __int64 lag = cur[ThreadManagement::STATS_HEADER / 8 + M * C + m];
+                double loopsPerSec = (dt > 0) ? (cur[base + SM_Stats::C_LOOPS] - prev[base + SM_Stats::C_LOOPS]) / dt : 0;
+                double rxPerSec    = (dt > 0) ? (cur[base + SM_Stats::C_BYTES_RX] - prev[base + SM_Stats::C_BYTES_RX]) / dt : 0;
+                Console::WriteLine("  {0,-11}{1,4}{2,10:F1}{3,10}{4,9}{5,11:F0}{6,10}{7,6}",
+                    names[m], (bits[m] == 0) ? (String^)"-" : ((hb & bits[m]) ? (String^)"ok" : "MISS"),
+                    loopsPerSec, cur[base + SM_Stats::C_FRAMES_PARSED], cur[base + SM_Stats::C_FRAMES_DROPPED],
+                    rxPerSec, cur[base + SM_Stats::C_PUBLISH_GEN], (lag < 0) ? (String^)"-" : lag.ToString());
+            }
+            array<__int64>^ t = prev; prev = cur; cur = t;
+            havePrev = true;
+        }
+        if (once) break;
+        Thread::Sleep(intervalMs);
+    }
+    delete view;
+    delete map;
+    return 0;
+}
+
+int main(array<System::String ^> ^ args)
+{
+    return StatsCli::run(args);
+}
+
+
+
+